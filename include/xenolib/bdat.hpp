@@ -19,8 +19,12 @@
 #include "core.hpp"
 #include "spike/type/pointer.hpp"
 #include "spike/util/supercore.hpp"
-#include <string_view>
+#include <cstring>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
 
 namespace BDAT {
 constexpr static uint32 ID = CompileFourCC("BDAT");
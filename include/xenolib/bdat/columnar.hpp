@@ -0,0 +1,162 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "xenolib/bdat/query.hpp"
+#include <span>
+
+/*
+BDCL - columnar BDAT export
+
+Little endian, every section is 8 byte aligned.
+All section offsets are absolute file offsets, string offsets are relative
+to string heap. File is meant to be memory mapped and read in place.
+
+  Header
+  Table[numTables]
+  per table: Column[numColumns], Key[numKeys]
+  per column: numRows * TypeSize(type) bytes of values
+  string heap: deduplicated, null terminated strings
+
+Columns are flat, as in TableView: V1 arrays are split into name[index]
+columns, V1 flags are stored as u8 columns of 0/1.
+StringPtr column values are uint32 offsets into string heap.
+Keys are V4 row hashes sorted by hash, V1 tables have none.
+*/
+
+namespace BDAT::Columnar {
+constexpr static uint32 ID = CompileFourCC("BDCL");
+constexpr static uint16 VERSION = 1;
+
+struct Header {
+  uint32 id;
+  uint16 version;
+  uint16 null0;
+  uint32 numTables;
+  uint32 stringsSize;
+  uint64 tables;
+  uint64 strings;
+};
+
+struct Table {
+  uint32 name;
+  uint32 numRows;
+  uint32 numColumns;
+  uint32 numKeys;
+  uint64 columns;
+  uint64 keys;
+};
+
+struct Column {
+  uint32 name;
+  DataType type;
+  uint8 null0[3];
+  uint64 data;
+};
+
+struct Key {
+  uint32 hash;
+  uint32 row;
+};
+
+static_assert(sizeof(Header) == 32);
+static_assert(sizeof(Table) == 32);
+static_assert(sizeof(Column) == 16);
+
+class WriterImpl;
+
+class XN_EXTERN Writer {
+public:
+  Writer();
+  ~Writer();
+
+  void AddTable(std::string_view name, const TableView &table,
+                std::span<const V4::Key> keys = {});
+  std::string Build() const;
+
+private:
+  std::unique_ptr<WriterImpl> pi;
+};
+
+class XN_EXTERN TableReader {
+public:
+  TableReader(const char *data_, const Table &table_)
+      : data(data_), table(&table_) {}
+
+  std::string_view Name() const { return HeapString(table->name); }
+  size_t NumRows() const { return table->numRows; }
+  size_t NumColumns() const { return table->numColumns; }
+  const Column &GetColumn(size_t index) const { return Columns()[index]; }
+  std::string_view ColumnName(size_t index) const {
+    return HeapString(GetColumn(index).name);
+  }
+  // Returns NumColumns() if not found
+  size_t FindColumn(std::string_view name) const;
+
+  // Column values, C must match size of column type
+  template <class C> std::span<const C> Values(size_t column) const {
+    const Column &col = GetColumn(column);
+
+    if (sizeof(C) != TypeSize(col.type)) {
+      throw std::runtime_error("Column value size mismatch");
+    }
+
+    return {reinterpret_cast<const C *>(data + col.data), table->numRows};
+  }
+
+  // Value of StringPtr column
+  std::string_view String(size_t row, size_t column) const {
+    return HeapString(Values<uint32>(column)[row]);
+  }
+
+  std::span<const Key> Keys() const {
+    return {reinterpret_cast<const Key *>(data + table->keys),
+            table->numKeys};
+  }
+  // Binary search over keys, returns -1 if not found
+  int64 FindRow(uint32 hash) const;
+
+private:
+  const char *data;
+  const Table *table;
+
+  const Column *Columns() const {
+    return reinterpret_cast<const Column *>(data + table->columns);
+  }
+  std::string_view HeapString(uint32 offset) const;
+};
+
+// Validates all headers on construction, column values are not checked.
+// Data must outlive reader and all returned views.
+class XN_EXTERN Reader {
+public:
+  Reader() = default;
+  Reader(std::string_view data);
+
+  size_t NumTables() const { return data.empty() ? 0 : Hdr().numTables; }
+  TableReader GetTable(size_t index) const;
+  // Returns NumTables() if not found
+  size_t FindTable(std::string_view name) const;
+
+private:
+  std::string_view data;
+
+  const Header &Hdr() const {
+    return *reinterpret_cast<const Header *>(data.data());
+  }
+};
+} // namespace BDAT::Columnar
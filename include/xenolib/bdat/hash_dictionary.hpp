@@ -0,0 +1,48 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "xenolib/bdat.hpp"
+
+namespace BDAT {
+// Label hash used by V4 data (murmur3, 32 bit)
+uint32 XN_EXTERN HashLabel(std::string_view label, uint32 seed = 0);
+
+class HashDictionaryImpl;
+
+// Resolves V4 hashes into names from user supplied list.
+// Lookup uses perfect hash table (hash and displace), that is
+// single probe per hash.
+class XN_EXTERN HashDictionary {
+public:
+  HashDictionary();
+  HashDictionary(HashDictionary &&);
+  ~HashDictionary();
+
+  // One name per line, empty lines and lines starting with # are skipped.
+  // Replaces previous contents.
+  void Load(std::string_view nameList);
+  size_t Size() const;
+  // Returns empty view if hash is unknown
+  std::string_view Find(uint32 hash) const;
+  // Resolves labels in <XXXXXXXX> form, other labels are returned as is
+  std::string Resolve(std::string_view label) const;
+
+private:
+  std::unique_ptr<HashDictionaryImpl> pi;
+};
+} // namespace BDAT
@@ -0,0 +1,100 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "xenolib/bdat/query.hpp"
+
+/*
+Cross table reference index.
+
+  BDAT::JoinIndex index;
+  index.AddTable({"ITM_Item", BDAT::TableView(itemHdr), {}, 1});
+  index.AddTable({"CHR_Pc", BDAT::TableView(pcHdr), {}, 1});
+  index.AddRelation("CHR_Pc", "DefWeapon", "ITM_Item");
+  index.Build();
+
+  for (auto &ref : index.Forward({pcTable, row})) {...}
+
+  std::string_view path[]{"DefWeapon", "Name"};
+  auto names = index.Resolve({pcTable, row}, path);
+
+Declared relations treat column value as row id of target table,
+row index = value - baseId.
+KeyHash columns are linked automatically to rows with matching V4 row key.
+*/
+
+namespace BDAT {
+struct JoinTable {
+  std::string name;
+  TableView view;
+  // V4 row hashes
+  std::span<const V4::Key> keys;
+  // Row id of first row, for declared relations
+  int64 baseId = 0;
+};
+
+struct RowRef {
+  uint32 table;
+  uint32 row;
+
+  bool operator==(const RowRef &) const = default;
+};
+
+struct Reference {
+  RowRef row;
+  // Column index of referencing table
+  uint32 column;
+};
+
+class JoinIndexImpl;
+
+// Built once, queries are thread safe.
+class XN_EXTERN JoinIndex {
+public:
+  JoinIndex();
+  JoinIndex(JoinIndex &&);
+  ~JoinIndex();
+
+  // Returns table index
+  uint32 AddTable(JoinTable table);
+  void AddRelation(std::string_view table, std::string_view column,
+                   std::string_view target);
+  void Build(bool linkKeyHashes = true);
+
+  const JoinTable &Table(uint32 index) const;
+  // Returns -1 if not found
+  int64 FindTable(std::string_view name) const;
+
+  // Rows referenced by row
+  std::span<const Reference> Forward(RowRef from) const;
+  // Rows referencing row, Reference::column belongs to referencing table
+  std::span<const Reference> Reverse(RowRef to) const;
+
+  // Follows forward references through columns in given order
+  std::vector<RowRef>
+  Follow(RowRef from, std::span<const std::string_view> columnPath) const;
+  // Follows all but last column, returns last column cells of reached rows
+  std::vector<Cell>
+  Resolve(RowRef from, std::span<const std::string_view> columnPath) const;
+  // All rows within maxHops forward (or reverse) references, excluding from
+  std::vector<RowRef> Reachable(RowRef from, size_t maxHops,
+                                bool reverse = false) const;
+
+private:
+  std::unique_ptr<JoinIndexImpl> pi;
+};
+} // namespace BDAT
@@ -0,0 +1,98 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "xenolib/bdat.hpp"
+#include <span>
+#include <vector>
+
+namespace BDAT {
+// Single addressable cell of a row.
+// V1 arrays are expanded into name[index] columns.
+// V1 flags are exposed as columns masking their owner value.
+struct ColumnView {
+  std::string name;
+  DataType type;
+  uint16 offset;
+  uint32 flagMask = 0;
+};
+
+struct Cell {
+  DataType type;
+  union {
+    int64 asInt;
+    float asFloat;
+    const char *asString;
+  };
+};
+
+// Flat column layout of processed data entry or V4::DataView
+struct XN_EXTERN TableView {
+  const char *values = nullptr;
+  size_t stride = 0;
+  size_t numRows = 0;
+  std::vector<ColumnView> columns;
+  // Decrypted string section
+  std::string_view strings;
+  // String cells are offsets into strings, not pointers
+  bool rawStrings = false;
+
+  TableView() = default;
+  TableView(const V1::Header *hdr);
+  TableView(const V4::Header *hdr);
+  TableView(const V4::DataView &view);
+
+  const ColumnView *FindColumn(std::string_view name) const;
+  Cell Get(size_t row, const ColumnView &column) const;
+};
+
+enum class CompareOp : uint8 {
+  Equal,
+  NotEqual,
+  Less,
+  LessEqual,
+  Greater,
+  GreaterEqual,
+  Contains,
+};
+
+struct Predicate {
+  std::string column;
+  CompareOp op;
+  std::string value;
+};
+
+// Parses expressions like Price>=100, Name~=Sword (contains) or Id==0x1F
+Predicate XN_EXTERN ParsePredicate(std::string_view expression);
+
+// Returns indices of rows that satisfy all predicates.
+// Tables that are missing any predicated column yield no rows.
+std::vector<size_t> XN_EXTERN FindRows(const TableView &table,
+                                       std::span<const Predicate> predicates);
+
+struct StringHit {
+  size_t row;
+  const ColumnView *column;
+  const char *value;
+};
+
+// Returns StringPtr cells containing needle, in row order.
+// String section is scanned first (SSE2 when available), tables without any
+// occurrence are rejected without visiting rows.
+std::vector<StringHit> XN_EXTERN FindString(const TableView &table,
+                                            std::string_view needle);
+} // namespace BDAT
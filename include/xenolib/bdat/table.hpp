@@ -0,0 +1,268 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "xenolib/bdat.hpp"
+#include "xenolib/bdat/hash_dictionary.hpp"
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <tuple>
+
+/*
+Typed row bindings for known table layouts.
+Columns are validated once against table descriptors, row accessors
+are plain loads at offsets resolved during validation.
+
+  struct ItemRow : BDAT::Schema<BDAT::Column<"Name", BDAT::DataType::StringPtr>,
+                                BDAT::Column<"Price", BDAT::DataType::u32>> {};
+
+  BDAT::Table<ItemRow> items(collection.FindData("ITM_Item"));
+
+  for (auto row : items) {
+    const char *name = row.Get<"Name">();
+    uint32 price = row.Get<"Price">();
+  }
+
+V4 column names are either plain or hashed, schema name matches both.
+V4 tables without string section have no names, their columns are matched
+by order instead.
+*/
+
+namespace BDAT {
+template <size_t N> struct FixedString {
+  char data[N]{};
+
+  constexpr FixedString(const char (&str)[N]) {
+    std::copy_n(str, N, data);
+  }
+
+  constexpr std::string_view View() const { return {data, N - 1}; }
+};
+
+template <DataType type> struct ColumnTraits;
+
+#define BDAT_COLUMN_TYPE(dtype, ctype)                                         \
+  template <> struct ColumnTraits<DataType::dtype> {                          \
+    using value_type = ctype;                                                  \
+  }
+
+BDAT_COLUMN_TYPE(u8, uint8);
+BDAT_COLUMN_TYPE(u16, uint16);
+BDAT_COLUMN_TYPE(u32, uint32);
+BDAT_COLUMN_TYPE(i8, int8);
+BDAT_COLUMN_TYPE(i16, int16);
+BDAT_COLUMN_TYPE(i32, int32);
+BDAT_COLUMN_TYPE(StringPtr, const char *);
+BDAT_COLUMN_TYPE(Float, float);
+BDAT_COLUMN_TYPE(KeyHash, uint32);
+BDAT_COLUMN_TYPE(Unk, uint32);
+BDAT_COLUMN_TYPE(Unk1, uint16);
+
+#undef BDAT_COLUMN_TYPE
+
+template <FixedString name_, DataType type_> struct Column {
+  static constexpr std::string_view name = name_.View();
+  static constexpr DataType type = type_;
+  using value_type = typename ColumnTraits<type_>::value_type;
+};
+
+template <class... C> struct Schema {
+  static constexpr size_t NUM_COLUMNS = sizeof...(C);
+  static constexpr std::array<std::string_view, NUM_COLUMNS> NAMES{C::name...};
+  static constexpr std::array<DataType, NUM_COLUMNS> TYPES{C::type...};
+
+  template <FixedString name> static constexpr size_t IndexOf() {
+    constexpr size_t index = [] {
+      for (size_t i = 0; i < NUM_COLUMNS; i++) {
+        if (NAMES[i] == name.View()) {
+          return i;
+        }
+      }
+
+      return NUM_COLUMNS;
+    }();
+
+    static_assert(index < NUM_COLUMNS, "Column is not part of schema");
+    return index;
+  }
+
+  template <size_t index>
+  using ColumnAt = std::tuple_element_t<index, std::tuple<C...>>;
+};
+
+template <class S> class RowView {
+public:
+  RowView(const char *data_, const uint16 *offsets_)
+      : data(data_), offsets(offsets_) {}
+
+  template <FixedString name> auto Get() const {
+    constexpr size_t index = S::template IndexOf<name>();
+    using column_type = typename S::template ColumnAt<index>;
+    const char *cell = data + offsets[index];
+
+    if constexpr (column_type::type == DataType::StringPtr) {
+      return reinterpret_cast<const Pointer<char> *>(cell)->Get();
+    } else {
+      typename column_type::value_type value;
+      memcpy(&value, cell, sizeof(value));
+      return value;
+    }
+  }
+
+  const char *Data() const { return data; }
+
+private:
+  const char *data;
+  const uint16 *offsets;
+};
+
+template <class S> class Table {
+public:
+  Table() = default;
+
+  Table(const V1::Header *hdr)
+      : values(hdr->keyValues), stride(hdr->kvBlockStride),
+        numRows(hdr->numKeyValues) {
+    const V1::KeyDesc *keyDescs = hdr->keyDescs;
+
+    for (size_t c = 0; c < S::NUM_COLUMNS; c++) {
+      auto found = std::find_if(
+          keyDescs, keyDescs + hdr->numKeyDescs,
+          [&](const V1::KeyDesc &k) { return S::NAMES[c] == k.name.Get(); });
+
+      if (found == keyDescs + hdr->numKeyDescs) {
+        throw std::runtime_error("Column " + std::string(S::NAMES[c]) +
+                                 " not found in " + hdr->name.Get());
+      }
+
+      const V1::BaseTypeDesc *desc = found->typeDesc;
+
+      if (desc->baseType != V1::BaseType::Default) {
+        throw std::runtime_error("Column " + std::string(S::NAMES[c]) +
+                                 " is not scalar");
+      }
+
+      auto &typeDesc = *static_cast<const V1::TypeDesc *>(desc);
+      Validate(c, typeDesc.type, typeDesc.offset);
+    }
+  }
+
+  Table(const V4::Header *hdr)
+      : values(hdr->values), stride(hdr->kvBlockSize), numRows(hdr->numKeys) {
+    if (hdr->numDescs < S::NUM_COLUMNS) {
+      throw std::runtime_error("Table has less columns than schema");
+    }
+
+    const V4::Descriptor *descs = hdr->descriptors;
+    std::vector<size_t> columnOffsets;
+    size_t curOffset = 0;
+
+    for (uint32 k = 0; k < hdr->numDescs; k++) {
+      columnOffsets.push_back(curOffset);
+      curOffset += TypeSize(descs[k].type);
+    }
+
+    if (!hdr->strings.Get() || !hdr->stringsSize) {
+      for (size_t c = 0; c < S::NUM_COLUMNS; c++) {
+        Validate(c, descs[c].type, columnOffsets[c]);
+      }
+
+      return;
+    }
+
+    std::vector<std::string> names;
+
+    for (uint32 k = 0; k < hdr->numDescs; k++) {
+      names.emplace_back(hdr->ColumnName(k));
+    }
+
+    for (size_t c = 0; c < S::NUM_COLUMNS; c++) {
+      char label[0x10]{};
+      snprintf(label, sizeof(label), "<%08" PRIX32 ">",
+               HashLabel(S::NAMES[c]));
+      auto found = std::find_if(names.begin(), names.end(), [&](auto &n) {
+        return n == S::NAMES[c] || n == label;
+      });
+
+      if (found == names.end()) {
+        throw std::runtime_error("Column " + std::string(S::NAMES[c]) +
+                                 " not found in " + hdr->Name());
+      }
+
+      const size_t k = std::distance(names.begin(), found);
+      Validate(c, descs[k].type, columnOffsets[k]);
+    }
+  }
+
+  size_t NumRows() const { return numRows; }
+  RowView<S> operator[](size_t index) const {
+    return {values + stride * index, offsets.data()};
+  }
+  RowView<S> At(size_t index) const {
+    if (index >= numRows) {
+      throw std::out_of_range("Row index is out of range");
+    }
+
+    return operator[](index);
+  }
+
+  struct iterator {
+    const Table *table;
+    size_t index;
+
+    RowView<S> operator*() const { return (*table)[index]; }
+    iterator &operator++() {
+      index++;
+      return *this;
+    }
+    bool operator==(const iterator &o) const { return index == o.index; }
+  };
+
+  iterator begin() const { return {this, 0}; }
+  iterator end() const { return {this, numRows}; }
+
+private:
+  const char *values = nullptr;
+  size_t stride = 0;
+  size_t numRows = 0;
+  std::array<uint16, S::NUM_COLUMNS> offsets{};
+
+  void Validate(size_t column, DataType type, size_t offset) {
+    if (S::TYPES[column] != type) {
+      throw std::runtime_error("Column " + std::string(S::NAMES[column]) +
+                               " type mismatch, expected " +
+                               std::to_string(int(S::TYPES[column])) +
+                               ", got " + std::to_string(int(type)));
+    }
+
+    if (offset + TypeSize(type) > stride) {
+      throw std::runtime_error("Column " + std::string(S::NAMES[column]) +
+                               " is out of row bounds");
+    }
+
+    if (offset > 0xffff) {
+      throw std::runtime_error("Column " + std::string(S::NAMES[column]) +
+                               " offset does not fit 16 bits");
+    }
+
+    offsets[column] = offset;
+  }
+};
+} // namespace BDAT
@@ -52,6 +52,8 @@ struct Stream {
   es::PointerX86<char> data;
 
   std::string XN_EXTERN GetData() const;
+  // Decompresses only given range of stream
+  std::string XN_EXTERN GetData(size_t offset, size_t size) const;
 };
 
 struct Texture {
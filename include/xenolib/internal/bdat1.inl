@@ -126,4 +126,29 @@ struct Collection {
 
   const Header XN_EXTERN *FindData(std::string_view name) const;
 };
+
+class LazyCollectionImpl;
+
+// Validates only collection header on load.
+// Every data entry is decrypted and swapped on first access.
+// Access is thread safe.
+class XN_EXTERN LazyCollection {
+public:
+  LazyCollection();
+  LazyCollection(LazyCollection &&);
+  ~LazyCollection();
+
+  void Load(std::string buffer);
+  size_t NumDatas() const;
+  const Header *Get(size_t index) const;
+  const Header *FindData(std::string_view name) const;
+  std::string_view DataName(size_t index) const;
+  // Content hashes of data entries before processing, for change detection.
+  // Must be called before first Get, not thread safe.
+  void ComputeHashes();
+  uint64 DataHash(size_t index) const;
+
+private:
+  std::unique_ptr<LazyCollectionImpl> pi;
+};
 } // namespace V1
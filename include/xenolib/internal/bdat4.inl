@@ -56,6 +56,11 @@ struct Header : HeaderBase {
   uint32 kvBlockSize;
   Pointer<char> strings;
   uint32 stringsSize;
+
+  // Hashed labels are returned as <XXXXXXXX>
+  std::string XN_EXTERN ColumnName(size_t index) const;
+  // Table name, hashed label is returned as <XXXXXXXX>
+  std::string XN_EXTERN Name() const;
 };
 
 struct Collection : HeaderBase {
@@ -69,4 +74,85 @@ struct Collection : HeaderBase {
   const Pointer<Header> *end() const { return datas + numDatas; }
 };
 
+class LazyCollectionImpl;
+
+// Validates only collection header on load.
+// Every data entry is fixed up on first access.
+// Access is thread safe.
+class XN_EXTERN LazyCollection {
+public:
+  LazyCollection();
+  LazyCollection(LazyCollection &&);
+  ~LazyCollection();
+
+  void Load(std::string buffer);
+  size_t NumDatas() const;
+  const Header *Get(size_t index) const;
+  // Read from header on load, hashed labels are returned as <XXXXXXXX>
+  std::string_view DataName(size_t index) const;
+  // Content hashes of data entries before processing, for change detection.
+  // Must be called before first Get, not thread safe.
+  void ComputeHashes();
+  uint64 DataHash(size_t index) const;
+
+private:
+  std::unique_ptr<LazyCollectionImpl> pi;
+};
+
+// Read-only access to unprocessed data entry.
+// String offsets are resolved on read, underlying memory is never written,
+// so it can be backed by read-only shared mapping.
+class XN_EXTERN DataView {
+public:
+  DataView() = default;
+  // Validates header and section bounds
+  DataView(std::string_view data);
+
+  const Header &Hdr() const {
+    return *reinterpret_cast<const Header *>(data.data());
+  }
+  size_t NumRows() const { return Hdr().numKeys; }
+  size_t NumColumns() const { return Hdr().numDescs; }
+  DataType ColumnType(size_t column) const;
+  size_t ColumnOffset(size_t column) const { return offsets.at(column); }
+  // Hashed labels are returned as <XXXXXXXX>
+  std::string Name() const;
+  std::string ColumnName(size_t column) const;
+  const Key *Keys() const;
+  const char *Row(size_t row) const;
+  std::string_view Strings() const;
+  // Returns nullptr for offsets outside of string table
+  const char *String(size_t row, size_t column) const;
+
+  template <class C> C Value(size_t row, size_t column) const {
+    C retVal;
+    memcpy(&retVal, Row(row) + ColumnOffset(column), sizeof(C));
+    return retVal;
+  }
+
+private:
+  std::string_view data;
+  std::vector<uint16> offsets;
+};
+
+// Read-only access to unprocessed collection.
+// Must outlive all returned views.
+class XN_EXTERN CollectionView {
+public:
+  CollectionView() = default;
+  // Validates collection header only
+  CollectionView(std::string_view data);
+  // Maps whole file instead of reading it, mapping is shared by copies.
+  // Pages are never written, so they stay shared with page cache.
+  static CollectionView Map(const std::string &path);
+
+  size_t NumDatas() const;
+  // Validates data entry on every call
+  DataView Get(size_t index) const;
+
+private:
+  std::string_view data;
+  std::shared_ptr<const void> mapping;
+};
+
 } // namespace V4
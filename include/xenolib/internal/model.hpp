@@ -22,10 +22,33 @@
 #include "xenolib/mxmd.hpp"
 #include <array>
 #include <cassert>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <optional>
+#include <vector>
 
 namespace MDO {
 using namespace MXMD;
+using MemoryResource = std::pmr::memory_resource;
+
+// uni::VectorList with storage allocated from memory resource, usually
+// arena owned by Wrap, so models are freed at once with their file.
+// Lists of one model must share resource, otherwise moves between them
+// degrade into copies.
+template <class I, class C> class ArenaList : public uni::List<I> {
+public:
+  std::pmr::vector<C> storage;
+
+  ArenaList(MemoryResource *resource = std::pmr::get_default_resource())
+      : storage(resource) {}
+
+  size_t Size() const override { return storage.size(); }
+  uni::Element<const I> At(size_t id) const override {
+    return storage.at(id);
+  }
+};
+
 struct PrimitiveDescriptor : uni::PrimitiveDescriptor {
   char *buffer;
   size_t stride;
@@ -50,12 +73,17 @@ struct PrimitiveDescriptor : uni::PrimitiveDescriptor {
 };
 
 struct VertexBuffer : uni::VertexArray {
-  uni::VectorList<uni::PrimitiveDescriptor, PrimitiveDescriptor> descs;
+  ArenaList<uni::PrimitiveDescriptor, PrimitiveDescriptor> descs;
   size_t numVertices = 0;
+  // Interleaved attributes, first layout.size() descs
+  std::span<const VertexType> layout;
 
   VertexBuffer() = default;
 
-  VertexBuffer(V1::VertexBuffer &buff) : numVertices(buff.data.numItems) {
+  VertexBuffer(V1::VertexBuffer &buff,
+               MemoryResource *resource = std::pmr::get_default_resource())
+      : descs(resource), numVertices(buff.data.numItems),
+        layout(buff.descriptors.begin(), buff.descriptors.numItems) {
     descs.storage.reserve(buff.descriptors.numItems);
     PrimitiveDescriptor desc{};
     desc.buffer = buff.data.items;
@@ -155,9 +183,11 @@ struct Bone : uni::Bone {
 };
 
 struct V1Skeleton : uni::Skeleton {
-  uni::VectorList<uni::Bone, Bone> bones;
+  ArenaList<uni::Bone, Bone> bones;
   V1Skeleton() = default;
-  V1Skeleton(V1::Bone *bone, size_t count) {
+  V1Skeleton(V1::Bone *bone, size_t count,
+             MemoryResource *resource = std::pmr::get_default_resource())
+      : bones(resource) {
     bones.storage.resize(count);
 
     for (size_t i = 0; i < count; i++) {
@@ -237,14 +267,17 @@ public:
 
 class V1Model : public Model {
 public:
-  uni::VectorList<uni::Primitive, Primitive> primitives;
-  uni::VectorList<uni::Skin, Skin> skins;
-  uni::VectorList<uni::Material, Material> materials;
-  uni::VectorList<uni::VertexArray, VertexBuffer> vertexArrays;
-  uni::VectorList<uni::IndexArray, IndexBuffer> indexArrays;
-
-  V1Model() = default;
-  V1Model(V1::Header &main);
+  ArenaList<uni::Primitive, Primitive> primitives;
+  ArenaList<uni::Skin, Skin> skins;
+  ArenaList<uni::Material, Material> materials;
+  ArenaList<uni::VertexArray, VertexBuffer> vertexArrays;
+  ArenaList<uni::IndexArray, IndexBuffer> indexArrays;
+
+  V1Model(MemoryResource *resource = std::pmr::get_default_resource())
+      : primitives(resource), skins(resource), materials(resource),
+        vertexArrays(resource), indexArrays(resource) {}
+  V1Model(V1::Header &main,
+          MemoryResource *resource = std::pmr::get_default_resource());
 
   uni::PrimitivesConst Primitives() const override {
     return uni::Element<const uni::List<uni::Primitive>>(&primitives, false);
@@ -291,9 +324,11 @@ struct V3Bone : uni::Bone {
 };
 
 struct V3Skeleton : uni::Skeleton {
-  uni::VectorList<uni::Bone, V3Bone> bones;
+  ArenaList<uni::Bone, V3Bone> bones;
   V3Skeleton() = default;
-  V3Skeleton(V3::Skin *skin) {
+  V3Skeleton(V3::Skin *skin,
+             MemoryResource *resource = std::pmr::get_default_resource())
+      : bones(resource) {
     bones.storage.resize(skin->count1);
 
     for (size_t i = 0; i < skin->count1; i++) {
@@ -362,14 +397,15 @@ public:
 
 class V3Morph : public Morph {
 public:
-  uni::VectorList<uni::PrimitiveDescriptor, PrimitiveDescriptor> descs;
+  ArenaList<uni::PrimitiveDescriptor, PrimitiveDescriptor> descs;
   size_t numVertices = 0;
   size_t targetBuffer = 0;
   size_t index;
 
   V3Morph() = default;
-  V3Morph(V3::MorphBuffer *buff, char *buffer)
-      : numVertices(buff->vertexBufferSize) {
+  V3Morph(V3::MorphBuffer *buff, char *buffer,
+          MemoryResource *resource = std::pmr::get_default_resource())
+      : descs(resource), numVertices(buff->vertexBufferSize) {
     PrimitiveDescriptor desc{};
     desc.buffer = buffer + buff->vertexBufferOffset;
     desc.stride = buff->stride;
@@ -462,11 +498,20 @@ public:
 
 class V3WeightSamplers_t : public WeightSamplers_t {
 public:
-  std::vector<std::array<V3WeightSampler, 16>> samplers;
+  std::pmr::vector<std::array<V3WeightSampler, 16>> samplers;
   V3::SkinManager *man;
+  VertexBuffer *buffer = nullptr;
+  // Packed ids and weights of every weight buffer row, decoded on first
+  // Resolve call. Behind pointer, so samplers stay movable.
+  std::unique_ptr<std::once_flag> decoded = std::make_unique<std::once_flag>();
+  mutable std::vector<uint32> boneIds;
+  mutable std::vector<uint32> boneWeights;
 
   V3WeightSamplers_t() = default;
-  V3WeightSamplers_t(V3::SkinManager *man_, VertexBuffer &buff) : man(man_) {
+  V3WeightSamplers_t(
+      V3::SkinManager *man_, VertexBuffer &buff,
+      MemoryResource *resource = std::pmr::get_default_resource())
+      : samplers(resource), man(man_), buffer(&buff) {
     samplers.resize(man->numLODs);
 
     for (auto &p : man->weightPalettes) {
@@ -502,22 +547,92 @@ public:
 
     return smplIndex;
   }
+
+  // Whole weight buffer at once, shared by all palettes
+  void DecodeWeights() const {
+    const size_t numRows = buffer->NumVertices();
+    boneIds.resize(numRows);
+    boneWeights.resize(numRows);
+
+    for (auto &d : buffer->descs.storage) {
+      switch (d.Usage()) {
+      case PrimitiveDescriptor::Usage_e::BoneWeights: {
+        uni::FormatCodec::fvec sampled;
+        d.Codec().Sample(sampled, d.RawBuffer(), numRows, d.Stride());
+
+        for (size_t r = 0; auto v : sampled) {
+          v.w = std::max(1.f - v.x - v.y - v.z, 0.f);
+          v *= 0xff;
+          v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
+          auto comp = v.Convert<uint8>();
+          boneWeights[r++] = reinterpret_cast<uint32 &>(comp);
+        }
+
+        break;
+      }
+      case PrimitiveDescriptor::Usage_e::BoneIndices: {
+        uni::FormatCodec::ivec sampled;
+        d.Codec().Sample(sampled, d.RawBuffer(), numRows, d.Stride());
+
+        for (size_t r = 0; auto &v : sampled) {
+          auto comp = v.Convert<uint8>();
+          boneIds[r++] = reinterpret_cast<uint32 &>(comp);
+        }
+
+        break;
+      }
+      default:
+        throw std::runtime_error("Unhandled vertex weight type");
+      }
+    }
+  }
+
+  void Resolve(std::span<const uint32> weightIndices,
+               std::span<const WeightRange> ranges,
+               std::vector<uint32> &outBoneIds,
+               std::vector<uint32> &outBoneWeights) const override {
+    std::call_once(*decoded, [this] { DecodeWeights(); });
+
+    outBoneIds.assign(weightIndices.size(), 0);
+    outBoneWeights.assign(weightIndices.size(), 0);
+    std::vector<bool> resolved(weightIndices.size(), false);
+
+    for (auto &r : ranges) {
+      if (r.maxId >= weightIndices.size()) {
+        throw std::out_of_range("Weight range is out of vertex array");
+      }
+
+      auto sampler = static_cast<const V3WeightSampler *>(Get(r.primitive));
+
+      for (uint32 v = r.minId; v <= r.maxId; v++) {
+        if (resolved[v]) {
+          continue;
+        }
+
+        const size_t row = weightIndices[v] + sampler->bufferOffset;
+        outBoneIds[v] = boneIds.at(row);
+        outBoneWeights[v] = boneWeights.at(row);
+        resolved[v] = true;
+      }
+    }
+  }
 };
 
 class V3Model : public Model {
 public:
-  uni::VectorList<uni::Primitive, V3Primitive> primitives;
-  uni::VectorList<uni::Skin, V3Skin> skins;
-  uni::VectorList<uni::VertexArray, VertexBuffer> vertexArrays;
-  uni::VectorList<uni::IndexArray, IndexBuffer> indexArrays;
-  uni::VectorList<Morph, V3Morph> morphs;
+  ArenaList<uni::Primitive, V3Primitive> primitives;
+  ArenaList<uni::Skin, V3Skin> skins;
+  ArenaList<uni::VertexArray, VertexBuffer> vertexArrays;
+  ArenaList<uni::IndexArray, IndexBuffer> indexArrays;
+  ArenaList<Morph, V3Morph> morphs;
   std::optional<V3WeightSamplers_t> weightSamplers;
-  std::vector<std::string_view> morphNames;
+  std::pmr::vector<std::string_view> morphNames;
   std::string streamBuffer;
   V3::Stream *stream = nullptr;
 
   V3Model() = default;
-  V3Model(V3::Model *model, BinReaderRef rd);
+  V3Model(V3::Model *model, BinReaderRef rd,
+          MemoryResource *resource = std::pmr::get_default_resource());
 
   uni::PrimitivesConst Primitives() const override {
     return uni::Element<const uni::List<uni::Primitive>>(&primitives, false);
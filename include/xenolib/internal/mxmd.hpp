@@ -20,6 +20,7 @@
 #include "spike/type/vectors.hpp"
 #include "spike/uni/model.hpp"
 #include "xenolib/drsm.hpp"
+#include "xenolib/mxmd.hpp"
 #include <variant>
 
 namespace MXMD {
@@ -112,6 +113,7 @@ static constexpr int ID = CompileFourCC("DMXM");
 using Variant = std::variant<std::reference_wrapper<V1::Header>,
                              std::reference_wrapper<V2::Header>,
                              std::reference_wrapper<V3::Header>>;
-class Wrap;
-Variant XN_EXTERN GetVariantFromWrapper(Wrap &wp);
+// Processes sections deferred by Wrap::LoadLazy, other than excluded
+Variant XN_EXTERN GetVariantFromWrapper(Wrap &wp,
+                                        Wrap::ExcludeLoads excludeLoads = {});
 } // namespace MXMD
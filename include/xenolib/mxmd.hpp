@@ -22,6 +22,7 @@
 #include "spike/uni/skeleton.hpp"
 #include <memory>
 #include <span>
+#include <string>
 
 namespace MXMD {
 class Impl;
@@ -42,9 +43,25 @@ public:
                         std::vector<uint32> &outBoneWeights) const = 0;
 };
 
+struct WeightRange {
+  const uni::Primitive *primitive;
+  // Inclusive vertex range of primitive within vertex array
+  uint32 minId;
+  uint32 maxId;
+};
+
 class WeightSamplers_t : public uni::Base {
 public:
   virtual const WeightSampler *Get(const uni::Primitive *prim) const = 0;
+  // Batch variant of WeightSampler::Resample for whole vertex array.
+  // weightIndices are VertexIndex values of vertex array.
+  // Output has packed ids and weights (4 x uint8) of every vertex, zero for
+  // vertices outside of ranges. Vertex within multiple ranges is resolved by
+  // palette of first one. Thread safe.
+  virtual void Resolve(std::span<const uint32> weightIndices,
+                       std::span<const WeightRange> ranges,
+                       std::vector<uint32> &outBoneIds,
+                       std::vector<uint32> &outBoneWeights) const = 0;
 };
 
 class Model : public uni::Model {
@@ -74,6 +91,11 @@ public:
 
   void Load(BinReaderRef main, BinReaderRef stream,
             ExcludeLoads excludeLoads = {});
+  // Maps file instead of reading it. Sections of little endian V3 files
+  // are processed on first access, other versions are processed on load.
+  // Stream must stay valid until first model access.
+  void LoadLazy(const std::string &path, BinReaderRef stream,
+                ExcludeLoads excludeLoads = {});
 
 private:
   friend class WrapFriend;
@@ -0,0 +1,79 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "xenolib/internal/mxmd.hpp"
+#include <memory>
+#include <span>
+
+/*
+Single pass decoder for interleaved vertex buffers.
+
+  MXMD::VertexDecoder decoder(layout);
+  std::vector<float> positions(numVertices * 3);
+  decoder.SetOutput(decoder.Find(MXMD::VertexDescriptorType::POSITION),
+                    MXMD::VertexFormat::Float, positions.data());
+  decoder.Decode(buffer, stride, numVertices);
+
+Outputs are tightly packed arrays, one per attribute.
+Element size is NumComponents * format size (Float4 is always 16 bytes).
+Layouts of common model buffers with default formats (or Float4 in place
+of Float) are decoded by specialized kernels, anything else by generic
+per attribute loop.
+*/
+
+namespace MXMD {
+enum class VertexFormat : uint8 {
+  Skip,
+  Float,
+  // Float, padded with zeroes to 4 components
+  Float4,
+  SNorm16,
+  UNorm16,
+  UNorm8,
+  UInt8,
+  UInt16,
+  UInt32,
+};
+
+class VertexDecoderImpl;
+
+class XN_EXTERN VertexDecoder {
+public:
+  VertexDecoder(std::span<const VertexType> layout);
+  VertexDecoder(VertexDecoder &&);
+  ~VertexDecoder();
+
+  // Float for float and normalized inputs, UInt8 for byte vectors,
+  // UInt32 for indices, Skip for unknown types
+  static VertexFormat DefaultFormat(VertexDescriptorType type);
+
+  size_t NumAttributes() const;
+  VertexType Attribute(size_t index) const;
+  // 0 for unknown types
+  size_t NumComponents(size_t index) const;
+  // Returns first attribute of type or -1
+  int64 Find(VertexDescriptorType type) const;
+  void SetOutput(size_t index, VertexFormat format, void *output);
+  // True if current layout and formats use specialized kernel
+  bool IsSpecialized() const;
+  void Decode(const char *buffer, size_t stride, size_t numVertices) const;
+
+private:
+  std::unique_ptr<VertexDecoderImpl> pi;
+};
+} // namespace MXMD
@@ -20,3 +20,7 @@
 #include "core.hpp"
 
 std::string XN_EXTERN DecompressXBC1(const char *data);
+// Decompresses only [offset, offset + size) range of uncompressed data.
+// Decoding stops at end of range.
+std::string XN_EXTERN DecompressXBC1(const char *data, size_t offset,
+                                     size_t size);
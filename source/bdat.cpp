@@ -16,10 +16,24 @@
 */
 
 #include "xenolib/bdat.hpp"
+#include "mapped_file.hpp"
 #include "spike/except.hpp"
 #include "spike/util/endian.hpp"
+#include "xenolib/bdat/query.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <charconv>
+#include <cinttypes>
+#include <cstring>
+#include <mutex>
 #include <random>
+#include <unordered_map>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace BDAT::V1 {
 bool KVPair::operator==(const Value &other) const {
@@ -435,3 +449,905 @@ void XN_EXTERN ProcessClass(BDAT::V4::Collection &item, ProcessFlags flags) {
     ProcessClass(*p.Get(), flags);
   }
 }
+
+namespace {
+// Word wise hash, used only for change detection
+uint64 HashBytes(std::string_view data) {
+  const uint64 PRIME0 = 0x9E3779B185EBCA87ULL;
+  const uint64 PRIME1 = 0xC2B2AE3D27D4EB4FULL;
+  uint64 hash = data.size() * PRIME0;
+  auto Round = [&](uint64 word) {
+    hash = std::rotl(hash ^ (word * PRIME1), 31) * PRIME0;
+  };
+  size_t index = 0;
+
+  for (; index + sizeof(uint64) <= data.size(); index += sizeof(uint64)) {
+    uint64 word;
+    memcpy(&word, data.data() + index, sizeof(word));
+    Round(word);
+  }
+
+  uint64 tail = 0;
+  memcpy(&tail, data.data() + index, data.size() - index);
+  Round(tail);
+
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDULL;
+  hash ^= hash >> 33;
+
+  return hash;
+}
+
+// Data entry spans until next data entry or end of buffer
+std::vector<uint64> HashDatas(std::string_view buffer,
+                              const std::vector<size_t> &offsets,
+                              bool accessed) {
+  // Processing rewrites data entry in place
+  if (accessed) {
+    throw std::logic_error("Data entries must be hashed before first access");
+  }
+
+  std::vector<size_t> sorted(offsets);
+  std::sort(sorted.begin(), sorted.end());
+  std::vector<uint64> hashes;
+  hashes.reserve(offsets.size());
+
+  for (size_t o : offsets) {
+    auto next = std::upper_bound(sorted.begin(), sorted.end(), o);
+    const size_t end = next == sorted.end() ? buffer.size() : *next;
+    hashes.push_back(HashBytes(buffer.substr(o, end - o)));
+  }
+
+  return hashes;
+}
+
+uint64 DataHashAt(const std::vector<uint64> &hashes, size_t index) {
+  if (hashes.empty()) {
+    throw std::logic_error("ComputeHashes was not called");
+  }
+
+  return hashes.at(index);
+}
+} // namespace
+
+namespace BDAT::V1 {
+class LazyCollectionImpl {
+public:
+  std::string buffer;
+  ProcessFlags flags{};
+  std::unique_ptr<std::once_flag[]> processed;
+  std::atomic_bool accessed;
+  std::vector<std::string> names;
+  std::vector<size_t> offsets;
+  std::vector<uint64> hashes;
+  std::unordered_map<std::string_view, size_t> nameLookup;
+
+  Collection &Main() { return reinterpret_cast<Collection &>(*buffer.data()); }
+
+  // Decrypts only name of data entry into separate string,
+  // data entry is left untouched.
+  std::string ReadName(const char *data) const {
+    Header hdr;
+    memcpy(static_cast<void *>(&hdr), data, sizeof(hdr));
+
+    if (flags == ProcessFlag::EnsureBigEndian) {
+      FByteswapper(hdr);
+    }
+
+    const int16 nameBegin = hdr.name.RawValue();
+    const int16 nameEnd = hdr.unk1Offset.RawValue();
+
+    if (nameBegin < 0 || nameEnd < nameBegin ||
+        size_t(data - buffer.data()) + nameEnd > buffer.size()) {
+      throw std::runtime_error("Data entry name is out of bounds");
+    }
+
+    uint8 curKey[]{uint8(~hdr.encKeys[1]), uint8(~hdr.encKeys[0])};
+    std::string retVal;
+
+    for (int16 i = nameBegin, curIndex = 0; i < nameEnd; i++, curIndex++) {
+      uint8 c = data[i];
+      char decrypted = c ^ curKey[curIndex % 2];
+      curKey[curIndex % 2] += c;
+
+      if (!decrypted) {
+        break;
+      }
+
+      retVal.push_back(decrypted);
+    }
+
+    return retVal;
+  }
+
+  void Load(std::string &&buffer_) {
+    buffer = std::move(buffer_);
+
+    if (buffer.size() < sizeof(Collection)) {
+      throw std::runtime_error("Collection is too small");
+    }
+
+    Collection &col = Main();
+    flags = {};
+
+    if (col.numDatas > 0x10000) {
+      flags += ProcessFlag::EnsureBigEndian;
+      FByteswapper(col);
+    }
+
+    if (sizeof(Collection) - sizeof(col.datas) +
+            size_t(col.numDatas) * sizeof(Pointer<Header>) >
+        buffer.size()) {
+      throw std::runtime_error("Collection is too small");
+    }
+
+    processed = std::make_unique<std::once_flag[]>(col.numDatas);
+    accessed = false;
+    names.clear();
+    names.reserve(col.numDatas);
+    offsets.clear();
+    offsets.reserve(col.numDatas);
+    hashes.clear();
+
+    for (auto &p : col) {
+      if (flags == ProcessFlag::EnsureBigEndian) {
+        FByteswapper(p);
+      }
+
+      if (p.RawValue() < 0 ||
+          size_t(p.RawValue()) + sizeof(Header) > buffer.size()) {
+        throw std::runtime_error("Data entry is out of bounds");
+      }
+
+      offsets.push_back(p.RawValue());
+      p.Fixup(buffer.data());
+      const char *data = reinterpret_cast<const char *>(p.Get());
+
+      if (uint32 id = *reinterpret_cast<const uint32 *>(data); id != BDAT::ID) {
+        throw es::InvalidHeaderError(id);
+      }
+
+      names.emplace_back(ReadName(data));
+    }
+
+    nameLookup.clear();
+
+    for (size_t index = 0; auto &n : names) {
+      nameLookup.emplace(n, index++);
+    }
+  }
+
+  Header *Get(size_t index) {
+    Collection &col = Main();
+
+    if (index >= col.numDatas) {
+      throw std::out_of_range("Data entry index is out of range");
+    }
+
+    Header *hdr = col.datas[index];
+    accessed = true;
+    std::call_once(processed[index], [&] { ProcessClass(*hdr, flags); });
+
+    return hdr;
+  }
+};
+
+LazyCollection::LazyCollection()
+    : pi(std::make_unique<LazyCollectionImpl>()) {}
+LazyCollection::LazyCollection(LazyCollection &&) = default;
+LazyCollection::~LazyCollection() = default;
+
+void LazyCollection::Load(std::string buffer) { pi->Load(std::move(buffer)); }
+
+size_t LazyCollection::NumDatas() const { return pi->names.size(); }
+
+const Header *LazyCollection::Get(size_t index) const {
+  return pi->Get(index);
+}
+
+const Header *LazyCollection::FindData(std::string_view name) const {
+  if (auto found = pi->nameLookup.find(name); found != pi->nameLookup.end()) {
+    return pi->Get(found->second);
+  }
+
+  return nullptr;
+}
+
+std::string_view LazyCollection::DataName(size_t index) const {
+  return pi->names.at(index);
+}
+
+void LazyCollection::ComputeHashes() {
+  pi->hashes = HashDatas(pi->buffer, pi->offsets, pi->accessed);
+}
+
+uint64 LazyCollection::DataHash(size_t index) const {
+  return DataHashAt(pi->hashes, index);
+}
+} // namespace BDAT::V1
+
+namespace BDAT::V4 {
+// Checks collection header and data entry offsets, without any fixups
+static const Collection &CheckCollection(std::string_view buffer) {
+  if (buffer.size() < sizeof(Collection)) {
+    throw std::runtime_error("Collection is too small");
+  }
+
+  auto &col = *reinterpret_cast<const Collection *>(buffer.data());
+
+  if (col.id != BDAT::ID) {
+    throw es::InvalidHeaderError(col.id);
+  }
+
+  if (col.type != Type::Collection) {
+    throw std::runtime_error("Supplied data are not collection");
+  }
+
+  if (sizeof(Collection) - sizeof(col.datas) +
+          size_t(col.numDatas) * sizeof(Pointer<Header>) >
+      buffer.size()) {
+    throw std::runtime_error("Collection is too small");
+  }
+
+  for (auto &p : col) {
+    if (p.RawValue() < 0 ||
+        size_t(p.RawValue()) + sizeof(Header) > buffer.size()) {
+      throw std::runtime_error("Data entry is out of bounds");
+    }
+  }
+
+  return col;
+}
+
+static std::string ColumnName(const Descriptor *descs, const char *strs,
+                              uint32 stringsSize, size_t index) {
+  const uint16 nameOffset = descs[index].NameOffset();
+
+  if (!strs || nameOffset >= stringsSize) {
+    return std::to_string(index);
+  }
+
+  // First byte of string table is zero for hashed labels
+  if (strs[0] == 0) {
+    if (nameOffset + sizeof(uint32) > stringsSize) {
+      return std::to_string(index);
+    }
+
+    uint32 hash;
+    memcpy(&hash, strs + nameOffset, sizeof(hash));
+    char data[0x10]{};
+    snprintf(data, sizeof(data), "<%08" PRIX32 ">", hash);
+    return data;
+  }
+
+  const char *name = strs + nameOffset;
+  return {name, strnlen(name, stringsSize - nameOffset)};
+}
+
+static std::string TableName(const char *strs, uint32 stringsSize) {
+  // Name follows label type byte
+  if (!strs || stringsSize < 2) {
+    return {};
+  }
+
+  if (strs[0] == 0) {
+    if (stringsSize < 1 + sizeof(uint32)) {
+      return {};
+    }
+
+    uint32 hash;
+    memcpy(&hash, strs + 1, sizeof(hash));
+    char data[0x10]{};
+    snprintf(data, sizeof(data), "<%08" PRIX32 ">", hash);
+    return data;
+  }
+
+  return {strs + 1, strnlen(strs + 1, stringsSize - 1)};
+}
+
+// Name of unprocessed data entry, reads header and name only
+static std::string RawTableName(std::string_view buffer, size_t offset) {
+  auto &hdr = *reinterpret_cast<const Header *>(buffer.data() + offset);
+  const auto strs = hdr.strings.RawValue();
+
+  if (strs < 0 || offset + strs + hdr.stringsSize > buffer.size()) {
+    return {};
+  }
+
+  return TableName(buffer.data() + offset + strs, hdr.stringsSize);
+}
+
+class LazyCollectionImpl {
+public:
+  std::string buffer;
+  std::unique_ptr<std::once_flag[]> processed;
+  std::atomic_bool accessed;
+  std::vector<std::string> names;
+  std::vector<size_t> offsets;
+  std::vector<uint64> hashes;
+
+  Collection &Main() { return reinterpret_cast<Collection &>(*buffer.data()); }
+
+  void Load(std::string &&buffer_) {
+    buffer = std::move(buffer_);
+    CheckCollection(buffer);
+    Collection &col = Main();
+    processed = std::make_unique<std::once_flag[]>(col.numDatas);
+    accessed = false;
+    names.clear();
+    names.reserve(col.numDatas);
+    offsets.clear();
+    offsets.reserve(col.numDatas);
+    hashes.clear();
+
+    for (auto &p : col) {
+      offsets.push_back(p.RawValue());
+      names.emplace_back(RawTableName(buffer, offsets.back()));
+      p.Fixup(buffer.data());
+    }
+  }
+
+  Header *Get(size_t index) {
+    Collection &col = Main();
+
+    if (index >= col.numDatas) {
+      throw std::out_of_range("Data entry index is out of range");
+    }
+
+    Header *hdr = col.datas[index];
+    accessed = true;
+    std::call_once(processed[index], [&] { ProcessClass(*hdr, {}); });
+
+    return hdr;
+  }
+};
+
+LazyCollection::LazyCollection()
+    : pi(std::make_unique<LazyCollectionImpl>()) {}
+LazyCollection::LazyCollection(LazyCollection &&) = default;
+LazyCollection::~LazyCollection() = default;
+
+void LazyCollection::Load(std::string buffer) { pi->Load(std::move(buffer)); }
+
+size_t LazyCollection::NumDatas() const {
+  return pi->buffer.empty() ? 0 : pi->Main().numDatas;
+}
+
+const Header *LazyCollection::Get(size_t index) const {
+  return pi->Get(index);
+}
+
+std::string_view LazyCollection::DataName(size_t index) const {
+  return pi->names.at(index);
+}
+
+void LazyCollection::ComputeHashes() {
+  pi->hashes = HashDatas(pi->buffer, pi->offsets, pi->accessed);
+}
+
+uint64 LazyCollection::DataHash(size_t index) const {
+  return DataHashAt(pi->hashes, index);
+}
+} // namespace BDAT::V4
+
+std::string BDAT::V4::Header::ColumnName(size_t index) const {
+  return V4::ColumnName(descriptors, strings, stringsSize, index);
+}
+
+std::string BDAT::V4::Header::Name() const {
+  return V4::TableName(strings, stringsSize);
+}
+
+namespace BDAT::V4 {
+DataView::DataView(std::string_view data_) : data(data_) {
+  if (data.size() < sizeof(Header)) {
+    throw std::runtime_error("Data entry is too small");
+  }
+
+  const Header &hdr = Hdr();
+
+  if (hdr.id != BDAT::ID) {
+    throw es::InvalidHeaderError(hdr.id);
+  }
+
+  auto CheckSection = [&](auto &ptr, size_t size) {
+    if (ptr.RawValue() < 0 || size_t(ptr.RawValue()) + size > data.size()) {
+      throw std::runtime_error("Data entry section is out of bounds");
+    }
+  };
+
+  CheckSection(hdr.descriptors, size_t(hdr.numDescs) * sizeof(Descriptor));
+  CheckSection(hdr.keys, size_t(hdr.numKeys) * sizeof(Key));
+  CheckSection(hdr.values, size_t(hdr.numKeys) * hdr.kvBlockSize);
+  CheckSection(hdr.strings, hdr.stringsSize);
+
+  auto descs = reinterpret_cast<const Descriptor *>(
+      data.data() + hdr.descriptors.RawValue());
+  size_t curOffset = 0;
+  offsets.reserve(hdr.numDescs);
+
+  for (uint32 k = 0; k < hdr.numDescs; k++) {
+    if (curOffset > 0xffff) {
+      throw std::runtime_error("Column offset does not fit 16 bits");
+    }
+
+    offsets.push_back(uint16(curOffset));
+    curOffset += TypeSize(descs[k].type);
+  }
+
+  if (curOffset > hdr.kvBlockSize) {
+    throw std::runtime_error("Columns are out of row bounds");
+  }
+}
+
+DataType DataView::ColumnType(size_t column) const {
+  auto descs = reinterpret_cast<const Descriptor *>(
+      data.data() + Hdr().descriptors.RawValue());
+
+  return descs[column].type;
+}
+
+std::string DataView::Name() const {
+  const Header &hdr = Hdr();
+  return V4::TableName(data.data() + hdr.strings.RawValue(), hdr.stringsSize);
+}
+
+std::string DataView::ColumnName(size_t column) const {
+  const Header &hdr = Hdr();
+  auto descs = reinterpret_cast<const Descriptor *>(
+      data.data() + hdr.descriptors.RawValue());
+
+  return V4::ColumnName(descs, data.data() + hdr.strings.RawValue(),
+                        hdr.stringsSize, column);
+}
+
+const Key *DataView::Keys() const {
+  return reinterpret_cast<const Key *>(data.data() + Hdr().keys.RawValue());
+}
+
+const char *DataView::Row(size_t row) const {
+  const Header &hdr = Hdr();
+  return data.data() + hdr.values.RawValue() + hdr.kvBlockSize * row;
+}
+
+std::string_view DataView::Strings() const {
+  const Header &hdr = Hdr();
+  return data.substr(hdr.strings.RawValue(), hdr.stringsSize);
+}
+
+const char *DataView::String(size_t row, size_t column) const {
+  const Header &hdr = Hdr();
+  const uint32 offset = Value<uint32>(row, column);
+
+  if (offset >= hdr.stringsSize) {
+    return nullptr;
+  }
+
+  return data.data() + hdr.strings.RawValue() + offset;
+}
+
+CollectionView::CollectionView(std::string_view data_) : data(data_) {
+  CheckCollection(data);
+}
+
+CollectionView CollectionView::Map(const std::string &path) {
+  auto mapped = std::make_shared<MappedFile>(path);
+  CollectionView retVal({mapped->Data(), mapped->Size()});
+  retVal.mapping = std::move(mapped);
+
+  return retVal;
+}
+
+size_t CollectionView::NumDatas() const {
+  if (data.empty()) {
+    return 0;
+  }
+
+  return reinterpret_cast<const Collection *>(data.data())->numDatas;
+}
+
+DataView CollectionView::Get(size_t index) const {
+  if (index >= NumDatas()) {
+    throw std::out_of_range("Data entry index is out of range");
+  }
+
+  auto &col = *reinterpret_cast<const Collection *>(data.data());
+  return DataView(data.substr(col.datas[index].RawValue()));
+}
+} // namespace BDAT::V4
+
+namespace BDAT {
+TableView::TableView(const V1::Header *hdr)
+    : values(hdr->keyValues), stride(hdr->kvBlockStride),
+      numRows(hdr->numKeyValues),
+      strings(hdr->strings.Get(), hdr->strings ? hdr->stringsSize : 0) {
+  const V1::KeyDesc *keyDescs = hdr->keyDescs;
+
+  for (uint16 k = 0; k < hdr->numKeyDescs; k++) {
+    auto &cDesc = keyDescs[k];
+    const V1::BaseTypeDesc *kDesc = cDesc.typeDesc;
+
+    switch (kDesc->baseType) {
+    case V1::BaseType::Default: {
+      auto &valueType = *static_cast<const V1::TypeDesc *>(kDesc);
+      columns.emplace_back(
+          ColumnView{cDesc.name.Get(), valueType.type, valueType.offset});
+      break;
+    }
+
+    case V1::BaseType::Array: {
+      auto &valueType = *static_cast<const V1::ArrayTypeDesc *>(kDesc);
+      const size_t typeLen = TypeSize(valueType.type);
+
+      for (uint16 a = 0; a < valueType.numItems; a++) {
+        columns.emplace_back(ColumnView{
+            std::string(cDesc.name.Get()) + '[' + std::to_string(a) + ']',
+            valueType.type, uint16(valueType.offset + a * typeLen)});
+      }
+      break;
+    }
+
+    case V1::BaseType::Flag: {
+      auto &flagType = *static_cast<const V1::FlagTypeDesc *>(kDesc);
+      const V1::KeyDesc *owner = flagType.belongsTo;
+      const V1::BaseTypeDesc *ownerDesc = owner->typeDesc;
+      auto &ownerType = *static_cast<const V1::TypeDesc *>(ownerDesc);
+      columns.emplace_back(ColumnView{cDesc.name.Get(), ownerType.type,
+                                      ownerType.offset, flagType.value});
+      break;
+    }
+
+    default:
+      break;
+    }
+  }
+}
+
+TableView::TableView(const V4::Header *hdr)
+    : values(hdr->values), stride(hdr->kvBlockSize), numRows(hdr->numKeys),
+      strings(hdr->strings.Get(), hdr->strings ? hdr->stringsSize : 0) {
+  const V4::Descriptor *descs = hdr->descriptors;
+  size_t curOffset = 0;
+
+  for (uint32 k = 0; k < hdr->numDescs; k++) {
+    if (curOffset > 0xffff) {
+      throw std::runtime_error("Column offset does not fit 16 bits");
+    }
+
+    columns.emplace_back(
+        ColumnView{hdr->ColumnName(k), descs[k].type, uint16(curOffset)});
+    curOffset += TypeSize(descs[k].type);
+  }
+}
+
+TableView::TableView(const V4::DataView &view)
+    : values(view.Row(0)), stride(view.Hdr().kvBlockSize),
+      numRows(view.NumRows()), strings(view.Strings()), rawStrings(true) {
+  for (size_t k = 0; k < view.NumColumns(); k++) {
+    columns.emplace_back(ColumnView{view.ColumnName(k), view.ColumnType(k),
+                                    uint16(view.ColumnOffset(k))});
+  }
+}
+
+const ColumnView *TableView::FindColumn(std::string_view name) const {
+  auto found = std::find_if(columns.begin(), columns.end(),
+                            [&](auto &c) { return c.name == name; });
+
+  return found == columns.end() ? nullptr : &*found;
+}
+
+Cell TableView::Get(size_t row, const ColumnView &column) const {
+  const char *data = values + stride * row + column.offset;
+  auto Load = [data](auto value) {
+    memcpy(&value, data, sizeof(value));
+    return value;
+  };
+
+  Cell cell;
+  cell.type = column.type;
+
+  switch (column.type) {
+  case DataType::i8:
+    cell.asInt = Load(int8{});
+    break;
+  case DataType::i16:
+    cell.asInt = Load(int16{});
+    break;
+  case DataType::i32:
+    cell.asInt = Load(int32{});
+    break;
+  case DataType::u8:
+    cell.asInt = Load(uint8{});
+    break;
+  case DataType::u16:
+  case DataType::Unk1:
+    cell.asInt = Load(uint16{});
+    break;
+  case DataType::u32:
+  case DataType::Unk:
+  case DataType::KeyHash:
+    cell.asInt = Load(uint32{});
+    break;
+  case DataType::Float:
+    cell.asFloat = Load(float{});
+    break;
+  case DataType::StringPtr:
+    if (rawStrings) {
+      const uint32 offset = Load(uint32{});
+      cell.asString =
+          offset < strings.size() ? strings.data() + offset : nullptr;
+    } else {
+      cell.asString = reinterpret_cast<const Pointer<char> *>(data)->Get();
+    }
+    break;
+  default:
+    throw std::runtime_error("Unhandled data type");
+  }
+
+  if (column.flagMask) {
+    cell.type = DataType::u8;
+    cell.asInt = (cell.asInt & column.flagMask) != 0;
+  }
+
+  return cell;
+}
+
+Predicate ParsePredicate(std::string_view expression) {
+  auto Trim = [](std::string_view str) {
+    while (!str.empty() && str.front() == ' ') {
+      str.remove_prefix(1);
+    }
+
+    while (!str.empty() && str.back() == ' ') {
+      str.remove_suffix(1);
+    }
+
+    return str;
+  };
+
+  static const std::pair<std::string_view, CompareOp> OPERATORS[]{
+      {"==", CompareOp::Equal},       {"!=", CompareOp::NotEqual},
+      {"<=", CompareOp::LessEqual},   {">=", CompareOp::GreaterEqual},
+      {"~=", CompareOp::Contains},    {"<", CompareOp::Less},
+      {">", CompareOp::Greater},      {"=", CompareOp::Equal},
+  };
+
+  const size_t opBegin = expression.find_first_of("=!<>~");
+
+  if (opBegin == expression.npos || opBegin == 0) {
+    throw std::runtime_error("Invalid predicate: " + std::string(expression));
+  }
+
+  std::string_view opStr = expression.substr(opBegin);
+
+  for (auto &[token, op] : OPERATORS) {
+    if (opStr.starts_with(token)) {
+      return Predicate{
+          .column = std::string(Trim(expression.substr(0, opBegin))),
+          .op = op,
+          .value = std::string(Trim(opStr.substr(token.size()))),
+      };
+    }
+  }
+
+  throw std::runtime_error("Invalid predicate: " + std::string(expression));
+}
+
+namespace {
+struct CompiledPredicate {
+  const ColumnView *column;
+  CompareOp op;
+  int64 asInt = 0;
+  float asFloat = 0;
+  std::string_view asString;
+};
+
+template <class C> bool Compare(const C &a, const C &b, CompareOp op) {
+  switch (op) {
+  case CompareOp::Equal:
+    return a == b;
+  case CompareOp::NotEqual:
+    return a != b;
+  case CompareOp::Less:
+    return a < b;
+  case CompareOp::LessEqual:
+    return a <= b;
+  case CompareOp::Greater:
+    return a > b;
+  case CompareOp::GreaterEqual:
+    return a >= b;
+  default:
+    return false;
+  }
+}
+
+bool Compile(const TableView &table, const Predicate &pred,
+             CompiledPredicate &out) {
+  out.column = table.FindColumn(pred.column);
+  out.op = pred.op;
+
+  if (!out.column) {
+    return false;
+  }
+
+  std::string_view value(pred.value);
+
+  if (out.column->type == DataType::StringPtr) {
+    out.asString = value;
+    return true;
+  }
+
+  if (pred.op == CompareOp::Contains) {
+    return false;
+  }
+
+  const char *end = value.data() + value.size();
+
+  if (out.column->type == DataType::Float && !out.column->flagMask) {
+    auto res = std::from_chars(value.data(), end, out.asFloat);
+    return res.ec == std::errc{} && res.ptr == end;
+  }
+
+  int base = 10;
+
+  if (value.starts_with("0x") || value.starts_with("0X")) {
+    value.remove_prefix(2);
+    base = 16;
+  } else if (value.starts_with('<') && value.ends_with('>')) {
+    value.remove_prefix(1);
+    value.remove_suffix(1);
+    end--;
+    base = 16;
+  }
+
+  auto res = std::from_chars(value.data(), end, out.asInt, base);
+  return res.ec == std::errc{} && res.ptr == end;
+}
+} // namespace
+
+std::vector<size_t> FindRows(const TableView &table,
+                             std::span<const Predicate> predicates) {
+  std::vector<CompiledPredicate> compiled(predicates.size());
+
+  for (size_t index = 0; auto &p : predicates) {
+    if (!Compile(table, p, compiled[index++])) {
+      return {};
+    }
+  }
+
+  std::vector<size_t> rows;
+
+  for (size_t r = 0; r < table.numRows; r++) {
+    const bool matches = std::all_of(
+        compiled.begin(), compiled.end(), [&](const CompiledPredicate &p) {
+          Cell cell = table.Get(r, *p.column);
+
+          switch (cell.type) {
+          case DataType::StringPtr: {
+            std::string_view str(cell.asString ? cell.asString : "");
+
+            if (p.op == CompareOp::Contains) {
+              return str.find(p.asString) != str.npos;
+            }
+
+            return Compare(str, p.asString, p.op);
+          }
+          case DataType::Float:
+            return Compare(cell.asFloat, p.asFloat, p.op);
+          default:
+            return Compare(cell.asInt, p.asInt, p.op);
+          }
+        });
+
+    if (matches) {
+      rows.push_back(r);
+    }
+  }
+
+  return rows;
+}
+
+namespace {
+// Calls cb(offset) for every occurrence of needle.
+// SSE2 path compares first and last needle characters for 16 positions at
+// once, only candidates are fully compared.
+template <class F>
+void FindOccurrences(std::string_view haystack, std::string_view needle,
+                     F &&cb) {
+  const size_t needleSize = needle.size();
+
+  if (!needleSize || haystack.size() < needleSize) {
+    return;
+  }
+
+  const char *data = haystack.data();
+  size_t index = 0;
+
+#ifdef __SSE2__
+  const __m128i first = _mm_set1_epi8(needle.front());
+  const __m128i last = _mm_set1_epi8(needle.back());
+
+  for (; index + needleSize - 1 + 16 <= haystack.size(); index += 16) {
+    auto blockFirst =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + index));
+    auto blockLast = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(data + index + needleSize - 1));
+    uint32 mask = _mm_movemask_epi8(_mm_and_si128(
+        _mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast)));
+
+    while (mask) {
+      const size_t offset = index + std::countr_zero(mask);
+
+      if (!memcmp(data + offset, needle.data(), needleSize)) {
+        cb(offset);
+      }
+
+      mask &= mask - 1;
+    }
+  }
+#endif
+
+  for (; index + needleSize <= haystack.size(); index++) {
+    if (!memcmp(data + index, needle.data(), needleSize)) {
+      cb(index);
+    }
+  }
+}
+} // namespace
+
+std::vector<StringHit> FindString(const TableView &table,
+                                  std::string_view needle) {
+  std::vector<size_t> occurrences;
+  FindOccurrences(table.strings, needle,
+                  [&](size_t offset) { occurrences.push_back(offset); });
+
+  if (occurrences.empty() || needle.empty()) {
+    return {};
+  }
+
+  std::vector<const ColumnView *> columns;
+
+  for (auto &c : table.columns) {
+    if (c.type == DataType::StringPtr) {
+      columns.push_back(&c);
+    }
+  }
+
+  std::vector<StringHit> hits;
+  const char *stringsBegin = table.strings.data();
+  const char *stringsEnd = stringsBegin + table.strings.size();
+
+  for (size_t r = 0; r < table.numRows; r++) {
+    for (auto c : columns) {
+      const char *str = table.Get(r, *c).asString;
+
+      if (!str) {
+        continue;
+      }
+
+      bool found = false;
+
+      if (str >= stringsBegin && str < stringsEnd) {
+        // String must contain occurrence that begins within its bounds
+        const size_t begin = str - stringsBegin;
+        const size_t strSize = strnlen(str, stringsEnd - str);
+
+        if (strSize >= needle.size()) {
+          auto occurrence = std::lower_bound(occurrences.begin(),
+                                             occurrences.end(), begin);
+          found = occurrence != occurrences.end() &&
+                  *occurrence <= begin + strSize - needle.size();
+        }
+      } else {
+        found = std::string_view(str).find(needle) != std::string_view::npos;
+      }
+
+      if (found) {
+        hits.push_back(StringHit{r, c, str});
+      }
+    }
+  }
+
+  return hits;
+}
+} // namespace BDAT
@@ -0,0 +1,281 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "xenolib/bdat/columnar.hpp"
+#include "spike/except.hpp"
+#include <algorithm>
+#include <unordered_map>
+
+namespace BDAT::Columnar {
+class WriterImpl {
+public:
+  struct ColumnData {
+    uint32 name;
+    DataType type;
+    std::string values;
+  };
+
+  struct TableData {
+    uint32 name;
+    uint32 numRows;
+    std::vector<ColumnData> columns;
+    std::vector<Key> keys;
+  };
+
+  std::string strings;
+  std::unordered_map<std::string, uint32> stringLookup;
+  std::vector<TableData> tables;
+
+  uint32 AddString(std::string_view str) {
+    auto [found, inserted] =
+        stringLookup.try_emplace(std::string(str), strings.size());
+
+    if (inserted) {
+      strings.append(str);
+      strings.push_back(0);
+    }
+
+    return found->second;
+  }
+
+  void AddTable(std::string_view name, const TableView &view,
+                std::span<const V4::Key> keys) {
+    TableData &table = tables.emplace_back();
+    table.name = AddString(name);
+    table.numRows = view.numRows;
+
+    for (auto &c : view.columns) {
+      ColumnData &column = table.columns.emplace_back();
+      column.name = AddString(c.name);
+      column.type = c.flagMask ? DataType::u8 : c.type;
+      const size_t typeSize = TypeSize(column.type);
+      column.values.resize(typeSize * view.numRows);
+      char *values = column.values.data();
+
+      for (size_t r = 0; r < view.numRows; r++, values += typeSize) {
+        Cell cell = view.Get(r, c);
+
+        switch (cell.type) {
+        case DataType::StringPtr: {
+          const uint32 offset = AddString(cell.asString ? cell.asString : "");
+          memcpy(values, &offset, typeSize);
+          break;
+        }
+        case DataType::Float:
+          memcpy(values, &cell.asFloat, typeSize);
+          break;
+        default:
+          // Little endian, narrowing keeps low bytes
+          memcpy(values, &cell.asInt, typeSize);
+          break;
+        }
+      }
+    }
+
+    for (auto &k : keys) {
+      table.keys.emplace_back(Key{k.hash, k.index});
+    }
+
+    std::sort(table.keys.begin(), table.keys.end(),
+              [](auto &a, auto &b) { return a.hash < b.hash; });
+  }
+
+  std::string Build() const {
+    auto Align = [](size_t offset) { return (offset + 7) & ~size_t(7); };
+    size_t curOffset = Align(sizeof(Header) + sizeof(Table) * tables.size());
+    std::vector<Table> tableHeaders;
+
+    for (auto &t : tables) {
+      Table &hdr = tableHeaders.emplace_back();
+      hdr.name = t.name;
+      hdr.numRows = t.numRows;
+      hdr.numColumns = t.columns.size();
+      hdr.numKeys = t.keys.size();
+      hdr.columns = curOffset;
+      curOffset = Align(curOffset + sizeof(Column) * t.columns.size());
+      hdr.keys = curOffset;
+      curOffset = Align(curOffset + sizeof(Key) * t.keys.size());
+    }
+
+    std::vector<std::vector<Column>> columnHeaders;
+
+    for (auto &t : tables) {
+      auto &columns = columnHeaders.emplace_back();
+
+      for (auto &c : t.columns) {
+        Column &hdr = columns.emplace_back();
+        hdr.name = c.name;
+        hdr.type = c.type;
+        hdr.data = curOffset;
+        curOffset = Align(curOffset + c.values.size());
+      }
+    }
+
+    Header hdr{};
+    hdr.id = ID;
+    hdr.version = VERSION;
+    hdr.numTables = tables.size();
+    hdr.stringsSize = strings.size();
+    hdr.tables = sizeof(Header);
+    hdr.strings = curOffset;
+
+    std::string retVal(curOffset + strings.size(), 0);
+    auto Write = [&](size_t offset, const void *item, size_t size) {
+      // Empty tables have no storage
+      if (size) {
+        memcpy(retVal.data() + offset, item, size);
+      }
+    };
+
+    Write(0, &hdr, sizeof(hdr));
+    Write(hdr.tables, tableHeaders.data(), sizeof(Table) * tables.size());
+
+    for (size_t t = 0; t < tables.size(); t++) {
+      auto &table = tables[t];
+      auto &columns = columnHeaders[t];
+      Write(tableHeaders[t].columns, columns.data(),
+            sizeof(Column) * columns.size());
+      Write(tableHeaders[t].keys, table.keys.data(),
+            sizeof(Key) * table.keys.size());
+
+      for (size_t c = 0; c < columns.size(); c++) {
+        Write(columns[c].data, table.columns[c].values.data(),
+              table.columns[c].values.size());
+      }
+    }
+
+    Write(hdr.strings, strings.data(), strings.size());
+
+    return retVal;
+  }
+};
+
+Writer::Writer() : pi(std::make_unique<WriterImpl>()) {}
+Writer::~Writer() = default;
+
+void Writer::AddTable(std::string_view name, const TableView &table,
+                      std::span<const V4::Key> keys) {
+  pi->AddTable(name, table, keys);
+}
+
+std::string Writer::Build() const { return pi->Build(); }
+
+size_t TableReader::FindColumn(std::string_view name) const {
+  for (size_t c = 0; c < NumColumns(); c++) {
+    if (ColumnName(c) == name) {
+      return c;
+    }
+  }
+
+  return NumColumns();
+}
+
+int64 TableReader::FindRow(uint32 hash) const {
+  auto keys = Keys();
+  auto found = std::lower_bound(
+      keys.begin(), keys.end(), hash,
+      [](const Key &key, uint32 hash) { return key.hash < hash; });
+
+  if (found == keys.end() || found->hash != hash) {
+    return -1;
+  }
+
+  return found->row;
+}
+
+std::string_view TableReader::HeapString(uint32 offset) const {
+  auto &hdr = *reinterpret_cast<const Header *>(data);
+
+  if (offset >= hdr.stringsSize) {
+    throw std::out_of_range("String offset is out of range");
+  }
+
+  return data + hdr.strings + offset;
+}
+
+Reader::Reader(std::string_view data_) : data(data_) {
+  if (data.size() < sizeof(Header)) {
+    throw std::runtime_error("Columnar data is too small");
+  }
+
+  const Header &hdr = Hdr();
+
+  if (hdr.id != ID) {
+    throw es::InvalidHeaderError(hdr.id);
+  }
+
+  if (hdr.version != VERSION) {
+    throw es::InvalidVersionError(hdr.version);
+  }
+
+  auto CheckSection = [&](uint64 offset, uint64 size) {
+    if (offset > data.size() || size > data.size() - offset) {
+      throw std::runtime_error("Columnar section is out of bounds");
+    }
+  };
+
+  CheckSection(hdr.strings, hdr.stringsSize);
+  CheckSection(hdr.tables, uint64(sizeof(Table)) * hdr.numTables);
+
+  if (hdr.stringsSize && data[hdr.strings + hdr.stringsSize - 1] != 0) {
+    throw std::runtime_error("String heap is not terminated");
+  }
+
+  auto CheckString = [&](uint32 offset) {
+    if (offset >= hdr.stringsSize) {
+      throw std::runtime_error("String offset is out of range");
+    }
+  };
+
+  auto tables = reinterpret_cast<const Table *>(data.data() + hdr.tables);
+
+  for (uint32 t = 0; t < hdr.numTables; t++) {
+    const Table &table = tables[t];
+    CheckString(table.name);
+    CheckSection(table.columns, uint64(sizeof(Column)) * table.numColumns);
+    CheckSection(table.keys, uint64(sizeof(Key)) * table.numKeys);
+
+    auto columns =
+        reinterpret_cast<const Column *>(data.data() + table.columns);
+
+    for (uint32 c = 0; c < table.numColumns; c++) {
+      CheckString(columns[c].name);
+      CheckSection(columns[c].data,
+                   uint64(TypeSize(columns[c].type)) * table.numRows);
+    }
+  }
+}
+
+TableReader Reader::GetTable(size_t index) const {
+  if (index >= NumTables()) {
+    throw std::out_of_range("Table index is out of range");
+  }
+
+  auto tables = reinterpret_cast<const Table *>(data.data() + Hdr().tables);
+  return {data.data(), tables[index]};
+}
+
+size_t Reader::FindTable(std::string_view name) const {
+  for (size_t t = 0; t < NumTables(); t++) {
+    if (GetTable(t).Name() == name) {
+      return t;
+    }
+  }
+
+  return NumTables();
+}
+} // namespace BDAT::Columnar
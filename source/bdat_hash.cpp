@@ -0,0 +1,234 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "xenolib/bdat/hash_dictionary.hpp"
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <vector>
+
+namespace BDAT {
+uint32 HashLabel(std::string_view label, uint32 seed) {
+  const uint32 C1 = 0xCC9E2D51;
+  const uint32 C2 = 0x1B873593;
+  const size_t numBlocks = label.size() / 4;
+  uint32 hash = seed;
+
+  for (size_t b = 0; b < numBlocks; b++) {
+    uint32 block;
+    memcpy(&block, label.data() + b * 4, sizeof(block));
+    block *= C1;
+    block = std::rotl(block, 15);
+    block *= C2;
+    hash ^= block;
+    hash = std::rotl(hash, 13);
+    hash = hash * 5 + 0xE6546B64;
+  }
+
+  const uint8 *tail =
+      reinterpret_cast<const uint8 *>(label.data()) + numBlocks * 4;
+  uint32 rest = 0;
+
+  switch (label.size() & 3) {
+  case 3:
+    rest ^= tail[2] << 16;
+    [[fallthrough]];
+  case 2:
+    rest ^= tail[1] << 8;
+    [[fallthrough]];
+  case 1:
+    rest ^= tail[0];
+    rest *= C1;
+    rest = std::rotl(rest, 15);
+    rest *= C2;
+    hash ^= rest;
+  }
+
+  hash ^= label.size();
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6B;
+  hash ^= hash >> 13;
+  hash *= 0xC2B2AE35;
+  hash ^= hash >> 16;
+
+  return hash;
+}
+
+class HashDictionaryImpl {
+public:
+  static constexpr uint32 EMPTY_SLOT = -1U;
+
+  std::string names;
+  size_t numNames = 0;
+  // Per bucket slot displacement
+  std::vector<uint32> displacements;
+  std::vector<uint32> slotHashes;
+  // Offset into names, or EMPTY_SLOT
+  std::vector<uint32> slotNames;
+
+  static uint32 Slot(uint32 hash, uint32 displacement, size_t numSlots) {
+    uint32 mixed = hash + displacement * 0x9E3779B9;
+    mixed ^= mixed >> 16;
+    mixed *= 0x7FEB352D;
+    mixed ^= mixed >> 15;
+    return mixed % numSlots;
+  }
+
+  void Build(std::vector<std::pair<uint32, uint32>> &entries) {
+    // Entries are in list order, first listed name of colliding hash wins
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](auto &a, auto &b) { return a.first < b.first; });
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                              [](auto &a, auto &b) {
+                                return a.first == b.first;
+                              }),
+                  entries.end());
+    numNames = entries.size();
+
+    const size_t numSlots = std::max<size_t>(entries.size() * 5 / 4, 1);
+    const size_t numBuckets = std::max<size_t>(entries.size() / 2, 1);
+    std::vector<std::vector<uint32>> buckets(numBuckets);
+
+    for (uint32 e = 0; e < entries.size(); e++) {
+      buckets[entries[e].first % numBuckets].push_back(e);
+    }
+
+    std::vector<uint32> order(numBuckets);
+
+    for (uint32 b = 0; b < numBuckets; b++) {
+      order[b] = b;
+    }
+
+    // Largest buckets are placed first, while table is mostly empty
+    std::stable_sort(order.begin(), order.end(), [&](uint32 a, uint32 b) {
+      return buckets[a].size() > buckets[b].size();
+    });
+
+    displacements.assign(numBuckets, 0);
+    slotHashes.assign(numSlots, 0);
+    slotNames.assign(numSlots, EMPTY_SLOT);
+    std::vector<uint32> bucketSlots;
+
+    for (uint32 b : order) {
+      auto &bucket = buckets[b];
+
+      if (bucket.empty()) {
+        break;
+      }
+
+      for (uint32 displacement = 0;; displacement++) {
+        bucketSlots.clear();
+        bool placed = true;
+
+        for (uint32 e : bucket) {
+          const uint32 slot =
+              Slot(entries[e].first, displacement, numSlots);
+
+          if (slotNames[slot] != EMPTY_SLOT ||
+              std::find(bucketSlots.begin(), bucketSlots.end(), slot) !=
+                  bucketSlots.end()) {
+            placed = false;
+            break;
+          }
+
+          bucketSlots.push_back(slot);
+        }
+
+        if (placed) {
+          displacements[b] = displacement;
+
+          for (size_t i = 0; i < bucket.size(); i++) {
+            slotHashes[bucketSlots[i]] = entries[bucket[i]].first;
+            slotNames[bucketSlots[i]] = entries[bucket[i]].second;
+          }
+
+          break;
+        }
+      }
+    }
+  }
+
+  std::string_view Find(uint32 hash) const {
+    if (displacements.empty()) {
+      return {};
+    }
+
+    const uint32 displacement = displacements[hash % displacements.size()];
+    const uint32 slot = Slot(hash, displacement, slotHashes.size());
+
+    if (slotNames[slot] == EMPTY_SLOT || slotHashes[slot] != hash) {
+      return {};
+    }
+
+    return names.data() + slotNames[slot];
+  }
+};
+
+HashDictionary::HashDictionary()
+    : pi(std::make_unique<HashDictionaryImpl>()) {}
+HashDictionary::HashDictionary(HashDictionary &&) = default;
+HashDictionary::~HashDictionary() = default;
+
+void HashDictionary::Load(std::string_view nameList) {
+  pi->names.clear();
+  std::vector<std::pair<uint32, uint32>> entries;
+
+  while (!nameList.empty()) {
+    const size_t lineEnd = nameList.find('\n');
+    std::string_view line = nameList.substr(0, lineEnd);
+    nameList.remove_prefix(lineEnd == nameList.npos ? nameList.size()
+                                                    : lineEnd + 1);
+
+    if (line.ends_with('\r')) {
+      line.remove_suffix(1);
+    }
+
+    if (line.empty() || line.starts_with('#')) {
+      continue;
+    }
+
+    entries.emplace_back(HashLabel(line), pi->names.size());
+    pi->names.append(line);
+    pi->names.push_back(0);
+  }
+
+  pi->Build(entries);
+}
+
+size_t HashDictionary::Size() const { return pi->numNames; }
+
+std::string_view HashDictionary::Find(uint32 hash) const {
+  return pi->Find(hash);
+}
+
+std::string HashDictionary::Resolve(std::string_view label) const {
+  if (label.size() == 10 && label.front() == '<' && label.back() == '>') {
+    uint32 hash;
+    const char *end = label.data() + 9;
+    auto res = std::from_chars(label.data() + 1, end, hash, 16);
+
+    if (res.ec == std::errc{} && res.ptr == end) {
+      if (std::string_view found = Find(hash); !found.empty()) {
+        return std::string(found);
+      }
+    }
+  }
+
+  return std::string(label);
+}
+} // namespace BDAT
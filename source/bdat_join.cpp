@@ -0,0 +1,312 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "xenolib/bdat/join.hpp"
+#include <algorithm>
+#include <unordered_set>
+
+namespace BDAT {
+class JoinIndexImpl {
+public:
+  struct Relation {
+    std::string table;
+    std::string column;
+    std::string target;
+  };
+
+  // Compressed adjacency list, references of global row i are
+  // within [offsets[i], offsets[i + 1])
+  struct Adjacency {
+    std::vector<uint32> offsets;
+    std::vector<Reference> references;
+
+    std::span<const Reference> Get(size_t globalRow) const {
+      if (globalRow + 1 >= offsets.size()) {
+        return {};
+      }
+
+      return {references.data() + offsets[globalRow],
+              references.data() + offsets[globalRow + 1]};
+    }
+  };
+
+  std::vector<JoinTable> tables;
+  std::vector<Relation> relations;
+  // Global row index of first row of table
+  std::vector<size_t> rowBase;
+  Adjacency forward;
+  Adjacency reverse;
+
+  int64 FindTable(std::string_view name) const {
+    auto found = std::find_if(tables.begin(), tables.end(),
+                              [&](auto &t) { return t.name == name; });
+
+    return found == tables.end() ? -1 : std::distance(tables.begin(), found);
+  }
+
+  size_t GlobalRow(RowRef ref) const {
+    if (ref.table >= tables.size() ||
+        ref.row >= tables[ref.table].view.numRows) {
+      throw std::out_of_range("Row reference is out of range");
+    }
+
+    return rowBase[ref.table] + ref.row;
+  }
+
+  void Build(bool linkKeyHashes) {
+    rowBase.clear();
+    size_t numRows = 0;
+
+    for (auto &t : tables) {
+      rowBase.push_back(numRows);
+      numRows += t.view.numRows;
+    }
+
+    struct KeyRef {
+      uint32 hash;
+      RowRef row;
+    };
+
+    std::vector<KeyRef> keys;
+
+    if (linkKeyHashes) {
+      for (uint32 t = 0; t < tables.size(); t++) {
+        for (auto &k : tables[t].keys) {
+          if (k.index < tables[t].view.numRows) {
+            keys.emplace_back(KeyRef{k.hash, RowRef{t, k.index}});
+          }
+        }
+      }
+
+      std::sort(keys.begin(), keys.end(),
+                [](auto &a, auto &b) { return a.hash < b.hash; });
+    }
+
+    // Declared target table per column
+    std::vector<std::vector<int64>> targets(tables.size());
+
+    for (uint32 t = 0; t < tables.size(); t++) {
+      targets[t].resize(tables[t].view.columns.size(), -1);
+    }
+
+    for (auto &r : relations) {
+      const int64 table = FindTable(r.table);
+      const int64 target = FindTable(r.target);
+
+      if (table < 0 || target < 0) {
+        throw std::runtime_error("Relation " + r.table + '.' + r.column +
+                                 " -> " + r.target + " uses unknown table");
+      }
+
+      auto &view = tables[table].view;
+      const ColumnView *column = view.FindColumn(r.column);
+
+      if (!column) {
+        throw std::runtime_error("Relation " + r.table + '.' + r.column +
+                                 " uses unknown column");
+      }
+
+      targets[table][column - view.columns.data()] = target;
+    }
+
+    struct Edge {
+      size_t from;
+      Reference to;
+    };
+
+    std::vector<Edge> edges;
+
+    for (uint32 t = 0; t < tables.size(); t++) {
+      auto &view = tables[t].view;
+
+      for (uint32 c = 0; c < view.columns.size(); c++) {
+        auto &column = view.columns[c];
+        const int64 target = targets[t][c];
+        const bool isHash = linkKeyHashes && column.type == DataType::KeyHash;
+
+        if (target < 0 && !isHash) {
+          continue;
+        }
+
+        if (target >= 0 && (column.type == DataType::StringPtr ||
+                            column.type == DataType::Float)) {
+          throw std::runtime_error("Relation column " + column.name +
+                                   " is not integer");
+        }
+
+        for (uint32 r = 0; r < view.numRows; r++) {
+          const int64 value = view.Get(r, column).asInt;
+          const size_t from = rowBase[t] + r;
+
+          if (target >= 0) {
+            const int64 row = value - tables[target].baseId;
+
+            if (row >= 0 && row < int64(tables[target].view.numRows)) {
+              edges.emplace_back(
+                  Edge{from, {{uint32(target), uint32(row)}, c}});
+            }
+          } else if (value) {
+            auto [begin, end] = std::equal_range(
+                keys.begin(), keys.end(), KeyRef{uint32(value), {}},
+                [](auto &a, auto &b) { return a.hash < b.hash; });
+
+            for (auto it = begin; it != end; it++) {
+              edges.emplace_back(Edge{from, {it->row, c}});
+            }
+          }
+        }
+      }
+    }
+
+    auto MakeAdjacency = [&](Adjacency &adj, auto &&key, auto &&value) {
+      adj.offsets.assign(numRows + 1, 0);
+      adj.references.resize(edges.size());
+
+      for (auto &e : edges) {
+        adj.offsets[key(e) + 1]++;
+      }
+
+      for (size_t i = 0; i < numRows; i++) {
+        adj.offsets[i + 1] += adj.offsets[i];
+      }
+
+      std::vector<uint32> cursor(adj.offsets.begin(), adj.offsets.end() - 1);
+
+      for (auto &e : edges) {
+        adj.references[cursor[key(e)]++] = value(e);
+      }
+    };
+
+    MakeAdjacency(
+        forward, [](const Edge &e) { return e.from; },
+        [](const Edge &e) { return e.to; });
+
+    auto ToRef = [&](size_t globalRow) {
+      auto table = std::upper_bound(rowBase.begin(), rowBase.end(), globalRow);
+      const uint32 tableIndex = std::distance(rowBase.begin(), table) - 1;
+      return RowRef{tableIndex, uint32(globalRow - rowBase[tableIndex])};
+    };
+
+    MakeAdjacency(
+        reverse, [&](const Edge &e) { return GlobalRow(e.to.row); },
+        [&](const Edge &e) {
+          return Reference{ToRef(e.from), e.to.column};
+        });
+  }
+};
+
+JoinIndex::JoinIndex() : pi(std::make_unique<JoinIndexImpl>()) {}
+JoinIndex::JoinIndex(JoinIndex &&) = default;
+JoinIndex::~JoinIndex() = default;
+
+uint32 JoinIndex::AddTable(JoinTable table) {
+  pi->tables.emplace_back(std::move(table));
+  return pi->tables.size() - 1;
+}
+
+void JoinIndex::AddRelation(std::string_view table, std::string_view column,
+                            std::string_view target) {
+  pi->relations.emplace_back(JoinIndexImpl::Relation{
+      std::string(table), std::string(column), std::string(target)});
+}
+
+void JoinIndex::Build(bool linkKeyHashes) { pi->Build(linkKeyHashes); }
+
+const JoinTable &JoinIndex::Table(uint32 index) const {
+  return pi->tables.at(index);
+}
+
+int64 JoinIndex::FindTable(std::string_view name) const {
+  return pi->FindTable(name);
+}
+
+std::span<const Reference> JoinIndex::Forward(RowRef from) const {
+  return pi->forward.Get(pi->GlobalRow(from));
+}
+
+std::span<const Reference> JoinIndex::Reverse(RowRef to) const {
+  return pi->reverse.Get(pi->GlobalRow(to));
+}
+
+std::vector<RowRef>
+JoinIndex::Follow(RowRef from,
+                  std::span<const std::string_view> columnPath) const {
+  std::vector<RowRef> current{from};
+
+  for (std::string_view columnName : columnPath) {
+    std::vector<RowRef> next;
+
+    for (RowRef row : current) {
+      auto &columns = pi->tables[row.table].view.columns;
+
+      for (auto &ref : Forward(row)) {
+        if (columns[ref.column].name == columnName) {
+          next.push_back(ref.row);
+        }
+      }
+    }
+
+    current = std::move(next);
+  }
+
+  return current;
+}
+
+std::vector<Cell>
+JoinIndex::Resolve(RowRef from,
+                   std::span<const std::string_view> columnPath) const {
+  if (columnPath.empty()) {
+    return {};
+  }
+
+  std::vector<Cell> retVal;
+
+  for (RowRef row : Follow(from, columnPath.first(columnPath.size() - 1))) {
+    auto &view = pi->tables[row.table].view;
+
+    if (auto column = view.FindColumn(columnPath.back())) {
+      retVal.push_back(view.Get(row.row, *column));
+    }
+  }
+
+  return retVal;
+}
+
+std::vector<RowRef> JoinIndex::Reachable(RowRef from, size_t maxHops,
+                                         bool reverse) const {
+  std::unordered_set<size_t> visited{pi->GlobalRow(from)};
+  std::vector<RowRef> retVal;
+  std::vector<RowRef> current{from};
+
+  for (size_t hop = 0; hop < maxHops && !current.empty(); hop++) {
+    std::vector<RowRef> next;
+
+    for (RowRef row : current) {
+      for (auto &ref : reverse ? Reverse(row) : Forward(row)) {
+        if (visited.emplace(pi->GlobalRow(ref.row)).second) {
+          next.push_back(ref.row);
+          retVal.push_back(ref.row);
+        }
+      }
+    }
+
+    current = std::move(next);
+  }
+
+  return retVal;
+}
+} // namespace BDAT
@@ -112,3 +112,7 @@ void XN_EXTERN ProcessClass(DRSM::Header &item, ProcessFlags flags) {
 }
 
 std::string DRSM::Stream::GetData() const { return DecompressXBC1(data); }
+
+std::string DRSM::Stream::GetData(size_t offset, size_t size) const {
+  return DecompressXBC1(data, offset, size);
+}
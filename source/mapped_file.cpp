@@ -0,0 +1,122 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "mapped_file.hpp"
+#include "spike/except.hpp"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile(const std::string &path) {
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+
+  if (file == INVALID_HANDLE_VALUE) {
+    throw es::FileNotFoundError(path);
+  }
+
+  LARGE_INTEGER fileSize;
+
+  if (!GetFileSizeEx(file, &fileSize)) {
+    CloseHandle(file);
+    throw std::runtime_error("Cannot get size of file: " + path);
+  }
+
+  size = fileSize.QuadPart;
+
+  if (!size) {
+    CloseHandle(file);
+    return;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+  CloseHandle(file);
+
+  if (!mapping) {
+    throw std::runtime_error("Cannot map file: " + path);
+  }
+
+  data = static_cast<char *>(MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+  CloseHandle(mapping);
+
+  if (!data) {
+    throw std::runtime_error("Cannot map file: " + path);
+  }
+}
+
+MappedFile::~MappedFile() {
+  if (data) {
+    UnmapViewOfFile(data);
+  }
+}
+#else
+MappedFile::MappedFile(const std::string &path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+
+  if (fd < 0) {
+    throw es::FileNotFoundError(path);
+  }
+
+  struct stat st;
+
+  if (fstat(fd, &st)) {
+    close(fd);
+    throw std::runtime_error("Cannot get size of file: " + path);
+  }
+
+  size = st.st_size;
+
+  if (!size) {
+    close(fd);
+    return;
+  }
+
+  void *mapped =
+      mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("Cannot map file: " + path);
+  }
+
+  data = static_cast<char *>(mapped);
+}
+
+MappedFile::~MappedFile() {
+  if (data) {
+    munmap(data, size);
+  }
+}
+#endif
+
+MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+  std::swap(data, other.data);
+  std::swap(size, other.size);
+  return *this;
+}
@@ -109,9 +109,12 @@ void XN_EXTERN ProcessClass(MSIM::V1::Header &item, ProcessFlags flags) {
 
 namespace MSIM {
 struct V1Skin : uni::Skin {
-  std::vector<size_t> indices;
+  std::pmr::vector<size_t> indices;
   V1::InstanceMatrix *matrices;
 
+  V1Skin(V1::InstanceMatrix *matrices_, MDO::MemoryResource *resource)
+      : indices(resource), matrices(matrices_) {}
+
   size_t NumNodes() const override { return indices.size(); }
   uni::TransformType TMType() const override {
     return uni::TransformType::TMTYPE_MATRIX;
@@ -130,8 +133,10 @@ struct V1Skin : uni::Skin {
 };
 
 struct V1Model : MDO::V1Model {
-  uni::VectorList<uni::Skin, V1Skin> skins;
-  using MDO::V1Model::V1Model;
+  MDO::ArenaList<uni::Skin, V1Skin> skins;
+
+  V1Model(MDO::MemoryResource *resource = std::pmr::get_default_resource())
+      : MDO::V1Model(resource), skins(resource) {}
 
   uni::SkinsConst Skins() const override {
     return uni::Element<const uni::List<uni::Skin>>(&skins, false);
@@ -144,7 +149,8 @@ struct VarModel {
 
   VarModel() = default;
   VarModel(VarModel &&) = default;
-  VarModel(auto &&any, size_t si) : model{any}, streamIndex(si) {}
+  VarModel(auto &&any, size_t si)
+      : model{std::forward<decltype(any)>(any)}, streamIndex(si) {}
 
   operator uni::Element<const uni::Model>() const {
     return uni::Element<const uni::Model>(
@@ -158,7 +164,9 @@ class Impl {
 public:
   std::string buffer;
   std::vector<std::string> streams;
-  uni::VectorList<const uni::Model, VarModel> models;
+  // Small containers of models, declared first so it outlives them
+  std::pmr::monotonic_buffer_resource arena;
+  MDO::ArenaList<const uni::Model, VarModel> models{&arena};
 
   void LoadV1(BinReaderRef rd, Wrap::ExcludeLoads excludeLoads) {
     rd.ReadContainer(buffer, rd.GetSize());
@@ -173,7 +181,7 @@ public:
       for (size_t index = 0; auto &m : mod->meshes) {
         models.storage.emplace_back(
             [&] {
-              V1Model mdo;
+              V1Model mdo(&arena);
 
               for (auto &p : m.primitives) {
                 mdo.primitives.storage.emplace_back(p);
@@ -200,8 +208,8 @@ public:
           auto &model = std::get<V1Model>(models.storage.at(mdlIndex).model);
 
           if (model.skins.storage.empty()) {
-            model.skins.storage.emplace_back().matrices =
-                instances->matrices.items.Get();
+            model.skins.storage.emplace_back(instances->matrices.items.Get(),
+                                             &arena);
           }
 
           auto &skin = model.skins.storage.front();
@@ -101,7 +101,8 @@ struct VarModel {
 
   VarModel() = default;
   VarModel(VarModel &&) = default;
-  VarModel(auto &&any, size_t si) : model{any}, streamIndex(si) {}
+  VarModel(auto &&any, size_t si)
+      : model{std::forward<decltype(any)>(any)}, streamIndex(si) {}
 
   operator uni::Element<const uni::Model>() const {
     return uni::Element<const uni::Model>(
@@ -115,7 +116,9 @@ class Impl {
 public:
   std::string buffer;
   std::vector<std::string> streams;
-  uni::VectorList<const uni::Model, VarModel> models;
+  // Small containers of models, declared first so it outlives them
+  std::pmr::monotonic_buffer_resource arena;
+  MDO::ArenaList<const uni::Model, VarModel> models{&arena};
 
   void LoadV1(BinReaderRef rd, Wrap::ExcludeLoads excludeLoads) {
     rd.ReadContainer(buffer, rd.GetSize());
@@ -139,7 +142,7 @@ public:
 
         models.storage.emplace_back(
             [&] {
-              MDO::V1Model mdo;
+              MDO::V1Model mdo(&arena);
 
               for (auto &p : m.primitives) {
                 mdo.primitives.storage.emplace_back(p).lod = lod;
@@ -22,6 +22,14 @@
 #include "spike/util/endian.hpp"
 #include "xenolib/drsm.hpp"
 #include "xenolib/internal/model.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <array>
+#include <numeric>
+
+#ifdef __SSSE3__
+#include <tmmintrin.h>
+#endif
 
 namespace MXMD {
 
@@ -271,6 +279,158 @@ void XN_EXTERN ProcessClass(V1::MaterialsHeader &item, ProcessFlags flags) {
   }
 }
 
+namespace {
+// Byte swap pattern of single vertex, built once per buffer layout
+struct VertexSwapper {
+  struct Element {
+    uint16 offset;
+    uint8 size;
+  };
+
+  std::vector<Element> elements;
+  // Buffer is swapped in 16 byte blocks, pattern repeats after
+  // lcm(stride, 16) bytes. Empty if any element could span two blocks.
+  std::vector<std::array<uint8, 16>> blockMasks;
+  size_t stride;
+
+  VertexSwapper(const V1::VertexBuffer &item) : stride(item.stride) {
+    size_t curOffset = 0;
+
+    auto AddElements = [&](size_t numElements, uint8 size) {
+      for (size_t e = 0; e < numElements; e++) {
+        elements.emplace_back(Element{uint16(curOffset + e * size), size});
+      }
+    };
+
+    for (auto &d : item.descriptors) {
+      switch (d.type) {
+      case VertexDescriptorType::POSITION:
+      case VertexDescriptorType::NORMAL32:
+      case VertexDescriptorType::WEIGHT32:
+        AddElements(3, 4);
+        break;
+      case VertexDescriptorType::WEIGHTID:
+        AddElements(1, 2);
+        break;
+      case VertexDescriptorType::UV1:
+      case VertexDescriptorType::UV2:
+      case VertexDescriptorType::UV3:
+      case VertexDescriptorType::UV4:
+        AddElements(2, 4);
+        break;
+      case VertexDescriptorType::WEIGHT16:
+      case VertexDescriptorType::TANGENT16:
+        AddElements(4, 2);
+        break;
+      case VertexDescriptorType::NORMAL:
+      case VertexDescriptorType::NORMAL2:
+      case VertexDescriptorType::TANGENT:
+      case VertexDescriptorType::TANGENT2:
+      case VertexDescriptorType::BONEID:
+      case VertexDescriptorType::BONEID2:
+      case VertexDescriptorType::VERTEXCOLOR:
+      case VertexDescriptorType::VERTEXCOLOR2:
+      case VertexDescriptorType::VERTEXCOLOR3:
+      case VertexDescriptorType::REFLECTION:
+        break;
+      default:
+        throw std::runtime_error("Unhandled vertex type");
+      }
+
+      curOffset += d.size;
+    }
+
+    if (!elements.empty() && elements.back().offset +
+                                     elements.back().size > stride) {
+      throw std::runtime_error("Vertex descriptors exceed stride");
+    }
+
+    // Element offsets aligned to their size never cross 16 byte boundary
+    const bool aligned =
+        stride % 4 == 0 && std::all_of(elements.begin(), elements.end(),
+                                       [](const Element &e) {
+                                         return e.offset % e.size == 0;
+                                       });
+
+    if (!aligned || elements.empty()) {
+      return;
+    }
+
+    blockMasks.resize(std::lcm(stride, size_t(16)) / 16);
+
+    for (size_t blk = 0; blk < blockMasks.size(); blk++) {
+      for (uint8 b = 0; b < 16; b++) {
+        blockMasks[blk][b] = b;
+      }
+    }
+
+    for (size_t v = 0; v < blockMasks.size() * 16 / stride; v++) {
+      for (auto &e : elements) {
+        const size_t offset = v * stride + e.offset;
+        auto &mask = blockMasks[offset / 16];
+
+        for (uint8 b = 0; b < e.size; b++) {
+          mask[offset % 16 + b] = offset % 16 + e.size - 1 - b;
+        }
+      }
+    }
+  }
+
+  void Swap(char *buffer, size_t numVerts) const {
+    if (elements.empty()) {
+      return;
+    }
+
+    size_t v = 0;
+
+#ifdef __SSSE3__
+    if (!blockMasks.empty()) {
+      const size_t numBlocks = numVerts * stride / 16;
+
+      for (size_t blk = 0, m = 0; blk < numBlocks; blk++) {
+        auto data = reinterpret_cast<__m128i *>(buffer + blk * 16);
+        auto mask =
+            _mm_loadu_si128(reinterpret_cast<const __m128i *>(&blockMasks[m]));
+        _mm_storeu_si128(data, _mm_shuffle_epi8(_mm_loadu_si128(data), mask));
+
+        if (++m == blockMasks.size()) {
+          m = 0;
+        }
+      }
+
+      // Elements of last vertex could be partially swapped by blocks
+      const size_t swappedEnd = numBlocks * 16;
+      v = swappedEnd / stride;
+
+      if (v < numVerts) {
+        for (auto &e : elements) {
+          if (v * stride + e.offset >= swappedEnd) {
+            SwapElement(buffer + v * stride, e);
+          }
+        }
+
+        v++;
+      }
+    }
+#endif
+
+    for (; v < numVerts; v++) {
+      for (auto &e : elements) {
+        SwapElement(buffer + v * stride, e);
+      }
+    }
+  }
+
+  static void SwapElement(char *vertex, Element e) {
+    if (e.size == 4) {
+      FByteswapper(*reinterpret_cast<uint32 *>(vertex + e.offset));
+    } else {
+      FByteswapper(*reinterpret_cast<uint16 *>(vertex + e.offset));
+    }
+  }
+};
+} // namespace
+
 template <>
 void XN_EXTERN ProcessClass(V1::VertexBuffer &item, ProcessFlags flags) {
   flags.NoProcessDataOut();
@@ -286,58 +446,8 @@ void XN_EXTERN ProcessClass(V1::VertexBuffer &item, ProcessFlags flags) {
     FByteswapper(d);
   }
 
-  const size_t numVerts = item.data.numItems;
-  char *buffer = item.data.items.Get();
-
-  for (auto &d : item.descriptors) {
-    switch (d.type) {
-    case VertexDescriptorType::POSITION:
-    case VertexDescriptorType::NORMAL32:
-    case VertexDescriptorType::WEIGHT32:
-      for (size_t i = 0; i < numVerts; i++) {
-        char *bufBegin = buffer + item.stride * i;
-        FByteswapper(*reinterpret_cast<Vector *>(bufBegin));
-      }
-      break;
-    case VertexDescriptorType::WEIGHTID:
-      for (size_t i = 0; i < numVerts; i++) {
-        char *bufBegin = buffer + item.stride * i;
-        FByteswapper(*reinterpret_cast<uint16 *>(bufBegin));
-      }
-      break;
-    case VertexDescriptorType::UV1:
-    case VertexDescriptorType::UV2:
-    case VertexDescriptorType::UV3:
-    case VertexDescriptorType::UV4:
-      for (size_t i = 0; i < numVerts; i++) {
-        char *bufBegin = buffer + item.stride * i;
-        FByteswapper(*reinterpret_cast<Vector2 *>(bufBegin));
-      }
-      break;
-    case VertexDescriptorType::WEIGHT16:
-    case VertexDescriptorType::TANGENT16:
-      for (size_t i = 0; i < numVerts; i++) {
-        char *bufBegin = buffer + item.stride * i;
-        FByteswapper(*reinterpret_cast<SVector4 *>(bufBegin));
-      }
-      break;
-    case VertexDescriptorType::NORMAL:
-    case VertexDescriptorType::NORMAL2:
-    case VertexDescriptorType::TANGENT:
-    case VertexDescriptorType::TANGENT2:
-    case VertexDescriptorType::BONEID:
-    case VertexDescriptorType::BONEID2:
-    case VertexDescriptorType::VERTEXCOLOR:
-    case VertexDescriptorType::VERTEXCOLOR2:
-    case VertexDescriptorType::VERTEXCOLOR3:
-    case VertexDescriptorType::REFLECTION:
-      break;
-    default:
-      throw std::runtime_error("Unhandled vertex type");
-    }
-
-    buffer += d.size;
-  }
+  // Whole vertices are swapped at once, by pattern built from descriptors
+  VertexSwapper(item).Swap(item.data.items.Get(), item.data.numItems);
 }
 
 template <>
@@ -695,52 +805,88 @@ template <> void XN_EXTERN ProcessClass(V2::Header &item, ProcessFlags flags) {
   }
 }
 
-template <> void XN_EXTERN ProcessClass(V3::Header &item, ProcessFlags flags) {
-  flags.NoProcessDataOut();
-  flags.NoAutoDetect();
-  flags.NoBigEndian();
-  flags.base = reinterpret_cast<char *>(&item);
-  Wrap::ExcludeLoads exLoads = static_cast<Wrap::ExcludeLoads>(flags.userData);
-  es::FixupPointers(flags.base, item.models, item.materials, item.streams,
+// Fixes up section pointers, excluded sections are reset.
+// Returns sections that need processing.
+static Wrap::ExcludeLoads FixupSections(V3::Header &item,
+                                        Wrap::ExcludeLoads exLoads) {
+  using ex = Wrap::ExcludeLoad;
+  char *base = reinterpret_cast<char *>(&item);
+  es::FixupPointers(base, item.models, item.materials, item.streams,
                     item.shaders, item.cachedTextures, item.uncachedTextures);
   assert(!item.cachedTextures);
   assert(!item.streams);
   assert(!item.shaders);
+  Wrap::ExcludeLoads retVal;
 
-  if (exLoads != Wrap::ExcludeLoad::Model && item.models) {
-    ProcessClass(*item.models, flags);
-    /*if (item.streams) {
-      ProcessClass(*item.streams, flags);
-    }*/
+  if (exLoads != ex::Model && item.models) {
+    retVal += ex::Model;
   } else {
     item.models.Reset();
     item.streams.Reset();
   }
 
-  if (exLoads != Wrap::ExcludeLoad::Shaders && item.shaders) {
-    // ProcessClass(*item.shaders, flags);
-  } else {
+  if (exLoads == ex::Shaders || !item.shaders) {
     item.shaders.Reset();
   }
 
-  if (exLoads != Wrap::ExcludeLoad::Materials && item.materials) {
-    ProcessClass(*item.materials, flags);
+  if (exLoads != ex::Materials && item.materials) {
+    retVal += ex::Materials;
   } else {
     item.materials.Reset();
   }
 
-  if (exLoads != Wrap::ExcludeLoad::LowTextures && item.cachedTextures) {
-    // ProcessClass(*item.cachedTextures, flags);
-  } else {
+  if (exLoads == ex::LowTextures || !item.cachedTextures) {
     item.cachedTextures.Reset();
   }
 
-  if (exLoads != Wrap::ExcludeLoad::TextureStreams && item.uncachedTextures) {
-    std::visit([flags](auto item) { ProcessClass(*item, flags); },
-               item.GetSMT());
+  if (exLoads != ex::TextureStreams && item.uncachedTextures) {
+    retVal += ex::TextureStreams;
   } else {
     item.uncachedTextures.Reset();
   }
+
+  return retVal;
+}
+
+static void ProcessSection(V3::Header &item, Wrap::ExcludeLoad section) {
+  ProcessFlags flags{};
+  flags.base = reinterpret_cast<char *>(&item);
+
+  switch (section) {
+  case Wrap::ExcludeLoad::Model:
+    ProcessClass(*item.models, flags);
+    break;
+  case Wrap::ExcludeLoad::Materials:
+    ProcessClass(*item.materials, flags);
+    break;
+  case Wrap::ExcludeLoad::TextureStreams:
+    std::visit([flags](auto item) { ProcessClass(*item, flags); },
+               item.GetSMT());
+    break;
+  default:
+    // Shaders and cached textures are not processed
+    break;
+  }
+}
+
+static constexpr Wrap::ExcludeLoad V3_SECTIONS[]{
+    Wrap::ExcludeLoad::Model,
+    Wrap::ExcludeLoad::Materials,
+    Wrap::ExcludeLoad::TextureStreams,
+};
+
+template <> void XN_EXTERN ProcessClass(V3::Header &item, ProcessFlags flags) {
+  flags.NoProcessDataOut();
+  flags.NoAutoDetect();
+  flags.NoBigEndian();
+  Wrap::ExcludeLoads sections =
+      FixupSections(item, static_cast<Wrap::ExcludeLoads>(flags.userData));
+
+  for (auto s : V3_SECTIONS) {
+    if (sections == s) {
+      ProcessSection(item, s);
+    }
+  }
 }
 
 template <>
@@ -780,13 +926,14 @@ V3::Header::SMTTextures V3::Header::GetSMT() {
   return reinterpret_cast<DRSM::Resources *>(uncachedTextures.Get());
 }
 
-MDO::V1Model::V1Model(V1::Header &main) {
+MDO::V1Model::V1Model(V1::Header &main, MemoryResource *resource)
+    : V1Model(resource) {
   auto model = main.models.Get();
   auto streams = main.streams.Get();
   auto mats = main.materials.Get();
 
   for (auto &v : streams->vertexBuffers) {
-    vertexArrays.storage.emplace_back(v);
+    vertexArrays.storage.emplace_back(v, resource);
   }
 
   for (auto &v : streams->indexBuffers) {
@@ -813,7 +960,10 @@ MDO::V1Model::V1Model(V1::Header &main) {
   }
 }
 
-MDO::V3Model::V3Model(V3::Model *model, BinReaderRef rd) {
+MDO::V3Model::V3Model(V3::Model *model, BinReaderRef rd,
+                      MemoryResource *resource)
+    : primitives(resource), skins(resource), vertexArrays(resource),
+      indexArrays(resource), morphs(resource), morphNames(resource) {
   {
     std::string dBuffer;
     rd.ReadContainer(dBuffer, rd.GetSize());
@@ -822,15 +972,16 @@ MDO::V3Model::V3Model(V3::Model *model, BinReaderRef rd) {
     DRSM::Resources *resources = dhdr->resources;
     auto &modelEntry =
         resources->streamEntries.items.Get()[resources->modelStreamEntryIndex];
-    streamBuffer = resources->streams.items.Get()[0].GetData().substr(
-        modelEntry.offset, modelEntry.size);
+    // Decoding stops at end of model entry
+    streamBuffer = resources->streams.items.Get()[0].GetData(modelEntry.offset,
+                                                             modelEntry.size);
   }
 
   stream = reinterpret_cast<V3::Stream *>(streamBuffer.data());
   ProcessClass(*stream, {});
 
   for (auto &v : stream->vertexBuffers) {
-    vertexArrays.storage.emplace_back(v);
+    vertexArrays.storage.emplace_back(v, resource);
   }
 
   if (stream->morphs) {
@@ -841,10 +992,10 @@ MDO::V3Model::V3Model(V3::Model *model, BinReaderRef rd) {
       v.AppendMorphBuffer(bbegin, bbuffer);
 
       for (size_t index = 2; auto &m : d.morphIDs) {
-        V3Morph mph(bbegin + index, bbuffer);
+        auto &mph = morphs.storage.emplace_back(bbegin + index, bbuffer,
+                                                resource);
         mph.targetBuffer = d.vertexBufferTargetIndex;
         mph.index = m;
-        morphs.storage.emplace_back(std::move(mph));
         index++;
       }
     }
@@ -870,9 +1021,10 @@ MDO::V3Model::V3Model(V3::Model *model, BinReaderRef rd) {
     skins.storage.emplace_back(sk);
 
     if (stream->skinManager) {
-      weightSamplers = V3WeightSamplers_t(
+      weightSamplers.emplace(
           stream->skinManager,
-          vertexArrays.storage.at(stream->skinManager->weightBufferID));
+          vertexArrays.storage.at(stream->skinManager->weightBufferID),
+          resource);
     }
   }
 }
@@ -882,38 +1034,97 @@ namespace MXMD {
 class Impl {
 public:
   std::string buffer;
+  MappedFile mapped;
+  char *data = nullptr;
+  // Small containers of skel and model, declared first so it outlives them
+  std::pmr::monotonic_buffer_resource arena;
+  // V3 sections deferred until first access
+  Wrap::ExcludeLoads pending;
+  BinReaderRef modelStream;
   std::variant<MDO::V1Skeleton, MDO::V3Skeleton> skel;
   std::variant<MDO::V1Model, MDO::V3Model> model;
 
+  HeaderBase &Hdr() { return *reinterpret_cast<HeaderBase *>(data); }
+
   void Load(BinReaderRef rd, BinReaderRef stream_,
             Wrap::ExcludeLoads excludeLoads) {
     rd.ReadContainer(buffer, rd.GetSize());
+    data = buffer.data();
+    ProcessAll(stream_, excludeLoads);
+  }
+
+  void LoadLazy(const std::string &path, BinReaderRef stream_,
+                Wrap::ExcludeLoads excludeLoads) {
+    mapped = MappedFile(path);
+    data = mapped.Data();
+
+    if (mapped.Size() < sizeof(V3::Header)) {
+      throw std::runtime_error("File is too small: " + path);
+    }
+
+    HeaderBase &hdr = Hdr();
+
+    // Big endian fixups touch whole file, no point in deferring
+    if (hdr.magic != ID || hdr.version != Versions::MXMDVer3) {
+      ProcessAll(stream_, excludeLoads);
+      return;
+    }
 
-    HeaderBase &hdr = reinterpret_cast<HeaderBase &>(*buffer.data());
+    pending = FixupSections(static_cast<V3::Header &>(hdr), excludeLoads);
+    modelStream = stream_;
+  }
+
+  void ProcessAll(BinReaderRef stream_, Wrap::ExcludeLoads excludeLoads) {
+    HeaderBase &hdr = Hdr();
     ProcessFlags flags{ProcessFlag::AutoDetectEndian};
     flags.userData = static_cast<uint32>(excludeLoads);
     ProcessClass(hdr, flags);
+    LoadModel(stream_);
+  }
+
+  void LoadModel(BinReaderRef stream_) {
+    HeaderBase &hdr = Hdr();
 
     if (hdr.version == Versions::MXMDVer1) {
       V1::Header &main = static_cast<V1::Header &>(hdr);
       if (main.models) {
-        skel = MDO::V1Skeleton(main.models->bones.items,
-                             main.models->bones.numItems);
-        model = MDO::V1Model(main);
+        skel.emplace<MDO::V1Skeleton>(main.models->bones.items,
+                                      main.models->bones.numItems, &arena);
+        model.emplace<MDO::V1Model>(main, &arena);
       }
     } else if (hdr.version == Versions::MXMDVer3) {
       V3::Header &main = static_cast<V3::Header &>(hdr);
       if (main.models) {
-        model = MDO::V3Model(main.models, stream_);
+        model.emplace<MDO::V3Model>(main.models, stream_, &arena);
         if (main.models->skin) {
-          skel = MDO::V3Skeleton(main.models->skin);
+          skel.emplace<MDO::V3Skeleton>(main.models->skin, &arena);
+        }
+      }
+    }
+  }
+
+  // Processes pending sections, other than excluded
+  void Require(Wrap::ExcludeLoads excludeLoads) {
+    for (auto s : V3_SECTIONS) {
+      if (pending == s && excludeLoads != s) {
+        pending -= s;
+        ProcessSection(static_cast<V3::Header &>(Hdr()), s);
+
+        if (s == Wrap::ExcludeLoad::Model) {
+          LoadModel(modelStream);
         }
       }
     }
   }
 
-  Variant GetVariant() {
-    HeaderBase &hdr = reinterpret_cast<HeaderBase &>(*buffer.data());
+  void RequireModel() {
+    using ex = Wrap::ExcludeLoad;
+    Require({ex::Materials, ex::LowTextures, ex::TextureStreams, ex::Shaders});
+  }
+
+  Variant GetVariant(Wrap::ExcludeLoads excludeLoads) {
+    Require(excludeLoads);
+    HeaderBase &hdr = Hdr();
 
     if (hdr.version == Versions::MXMDVer1) {
       return std::ref(static_cast<V1::Header &>(hdr));
@@ -936,11 +1147,18 @@ void Wrap::Load(BinReaderRef main, BinReaderRef stream,
   pi->Load(main, stream, excludeLoads);
 }
 
+void Wrap::LoadLazy(const std::string &path, BinReaderRef stream,
+                    ExcludeLoads excludeLoads) {
+  pi->LoadLazy(path, stream, excludeLoads);
+}
+
 Wrap::operator const uni::Skeleton *() {
+  pi->RequireModel();
   return std::visit([](auto &item) -> uni::Skeleton * { return &item; },
                     pi->skel);
 }
 Wrap::operator const Model *() {
+  pi->RequireModel();
   return std::visit([](auto &item) -> Model * { return &item; }, pi->model);
 }
 
@@ -949,7 +1167,7 @@ public:
   using Wrap::pi;
 };
 
-Variant GetVariantFromWrapper(Wrap &wp) {
-  return static_cast<WrapFriend &>(wp).pi->GetVariant();
+Variant GetVariantFromWrapper(Wrap &wp, Wrap::ExcludeLoads excludeLoads) {
+  return static_cast<WrapFriend &>(wp).pi->GetVariant(excludeLoads);
 }
 } // namespace MXMD
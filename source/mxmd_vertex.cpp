@@ -0,0 +1,416 @@
+/*  Xenoblade Engine Format Library
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "xenolib/mxmd/vertex_decoder.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace MXMD {
+namespace {
+enum class InputFormat : uint8 {
+  None,
+  Float3,
+  Float2,
+  SNorm8x4,
+  SNorm16x4,
+  UNorm16x4,
+  UInt8x4,
+  UInt16,
+};
+
+InputFormat GetInputFormat(VertexDescriptorType type) {
+  switch (type) {
+  case VertexDescriptorType::POSITION:
+  case VertexDescriptorType::NORMAL32:
+  case VertexDescriptorType::WEIGHT32:
+    return InputFormat::Float3;
+  case VertexDescriptorType::UV1:
+  case VertexDescriptorType::UV2:
+  case VertexDescriptorType::UV3:
+  case VertexDescriptorType::UV4:
+    return InputFormat::Float2;
+  case VertexDescriptorType::NORMAL:
+  case VertexDescriptorType::TANGENT:
+  case VertexDescriptorType::TANGENT2:
+  case VertexDescriptorType::NORMAL2:
+    return InputFormat::SNorm8x4;
+  case VertexDescriptorType::TANGENT16:
+    return InputFormat::SNorm16x4;
+  case VertexDescriptorType::WEIGHT16:
+    return InputFormat::UNorm16x4;
+  case VertexDescriptorType::BONEID:
+  case VertexDescriptorType::BONEID2:
+  case VertexDescriptorType::VERTEXCOLOR:
+  case VertexDescriptorType::VERTEXCOLOR2:
+  case VertexDescriptorType::VERTEXCOLOR3:
+    return InputFormat::UInt8x4;
+  case VertexDescriptorType::WEIGHTID:
+    return InputFormat::UInt16;
+  default:
+    return InputFormat::None;
+  }
+}
+
+template <InputFormat I> struct Input;
+
+template <class C, size_t N, bool INT> struct InputBase {
+  using value_type = C;
+  static constexpr size_t NUM_COMPONENTS = N;
+  static constexpr size_t SIZE = sizeof(C) * N;
+  static constexpr bool IS_INT = INT;
+};
+
+template <> struct Input<InputFormat::None> : InputBase<uint8, 0, true> {
+  static float ToFloat(uint8) { return 0; }
+};
+
+template <> struct Input<InputFormat::Float3> : InputBase<float, 3, false> {
+  static float ToFloat(float v) { return v; }
+};
+
+template <> struct Input<InputFormat::Float2> : InputBase<float, 2, false> {
+  static float ToFloat(float v) { return v; }
+};
+
+template <> struct Input<InputFormat::SNorm8x4> : InputBase<int8, 4, false> {
+  static float ToFloat(int8 v) { return std::max(v / 127.f, -1.f); }
+};
+
+template <>
+struct Input<InputFormat::SNorm16x4> : InputBase<int16, 4, false> {
+  static float ToFloat(int16 v) { return std::max(v / 32767.f, -1.f); }
+};
+
+template <>
+struct Input<InputFormat::UNorm16x4> : InputBase<uint16, 4, false> {
+  static float ToFloat(uint16 v) { return v / 65535.f; }
+};
+
+template <> struct Input<InputFormat::UInt8x4> : InputBase<uint8, 4, true> {
+  static float ToFloat(uint8 v) { return v; }
+};
+
+template <> struct Input<InputFormat::UInt16> : InputBase<uint16, 1, true> {
+  static float ToFloat(uint16 v) { return v; }
+};
+
+template <VertexFormat O> struct Output;
+
+template <class C> struct OutputBase {
+  using value_type = C;
+
+  static C FromInt(uint32 v) {
+    return C(std::min<uint32>(v, std::numeric_limits<C>::max()));
+  }
+};
+
+template <class C> struct NormOutput : OutputBase<C> {
+  static C FromFloat(float v) {
+    constexpr float MAX = std::numeric_limits<C>::max();
+    constexpr float MIN = std::is_signed_v<C> ? -1.f : 0.f;
+    return C(std::round(std::clamp(v, MIN, 1.f) * MAX));
+  }
+};
+
+template <class C> struct IntOutput : OutputBase<C> {
+  static C FromFloat(float v) {
+    return C(std::clamp(v, 0.f, float(std::numeric_limits<C>::max())));
+  }
+};
+
+template <> struct Output<VertexFormat::Float> {
+  using value_type = float;
+  static float FromFloat(float v) { return v; }
+  static float FromInt(uint32 v) { return float(v); }
+};
+
+template <>
+struct Output<VertexFormat::Float4> : Output<VertexFormat::Float> {};
+template <> struct Output<VertexFormat::SNorm16> : NormOutput<int16> {};
+template <> struct Output<VertexFormat::UNorm16> : NormOutput<uint16> {};
+template <> struct Output<VertexFormat::UNorm8> : NormOutput<uint8> {};
+template <> struct Output<VertexFormat::UInt8> : IntOutput<uint8> {};
+template <> struct Output<VertexFormat::UInt16> : IntOutput<uint16> {};
+template <> struct Output<VertexFormat::UInt32> : IntOutput<uint32> {};
+
+// Converts attribute of single vertex
+template <InputFormat I, VertexFormat O> struct Op {
+  using in_type = Input<I>;
+  using out_type = Output<O>;
+  using out_value = typename out_type::value_type;
+  static constexpr InputFormat INPUT = I;
+  static constexpr VertexFormat OUTPUT = O;
+  static constexpr size_t NUM_OUT = O == VertexFormat::Float4
+                                        ? 4
+                                        : in_type::NUM_COMPONENTS;
+  static constexpr size_t OUT_SIZE = sizeof(out_value) * NUM_OUT;
+
+  static void Run(const char *in, char *out) {
+    typename in_type::value_type values[in_type::NUM_COMPONENTS + 1];
+    memcpy(values, in, in_type::SIZE);
+    out_value converted[NUM_OUT + 1]{};
+
+    for (size_t c = 0; c < in_type::NUM_COMPONENTS; c++) {
+      if constexpr (in_type::IS_INT) {
+        converted[c] = out_type::FromInt(values[c]);
+      } else {
+        converted[c] = out_type::FromFloat(in_type::ToFloat(values[c]));
+      }
+    }
+
+    memcpy(out, converted, OUT_SIZE);
+  }
+};
+
+template <InputFormat I> struct Op<I, VertexFormat::Skip> {
+  static constexpr InputFormat INPUT = I;
+  static constexpr VertexFormat OUTPUT = VertexFormat::Skip;
+  static constexpr size_t OUT_SIZE = 0;
+  static void Run(const char *, char *) {}
+};
+
+using OpFunc = void (*)(const char *, char *);
+
+struct OpInfo {
+  OpFunc func;
+  size_t outSize;
+};
+
+template <InputFormat I, VertexFormat O> constexpr OpInfo MakeOp() {
+  return {Op<I, O>::Run, Op<I, O>::OUT_SIZE};
+}
+
+template <InputFormat I>
+constexpr std::array<OpInfo, 9> OPS_FOR_INPUT{
+    MakeOp<I, VertexFormat::Skip>(),    MakeOp<I, VertexFormat::Float>(),
+    MakeOp<I, VertexFormat::Float4>(),  MakeOp<I, VertexFormat::SNorm16>(),
+    MakeOp<I, VertexFormat::UNorm16>(), MakeOp<I, VertexFormat::UNorm8>(),
+    MakeOp<I, VertexFormat::UInt8>(),   MakeOp<I, VertexFormat::UInt16>(),
+    MakeOp<I, VertexFormat::UInt32>(),
+};
+
+constexpr std::array<std::array<OpInfo, 9>, 8> OPS{
+    OPS_FOR_INPUT<InputFormat::None>,
+    OPS_FOR_INPUT<InputFormat::Float3>,
+    OPS_FOR_INPUT<InputFormat::Float2>,
+    OPS_FOR_INPUT<InputFormat::SNorm8x4>,
+    OPS_FOR_INPUT<InputFormat::SNorm16x4>,
+    OPS_FOR_INPUT<InputFormat::UNorm16x4>,
+    OPS_FOR_INPUT<InputFormat::UInt8x4>,
+    OPS_FOR_INPUT<InputFormat::UInt16>,
+};
+
+struct AttributeDesc {
+  VertexType type;
+  InputFormat input;
+  size_t offset;
+  VertexFormat format = VertexFormat::Skip;
+  char *output = nullptr;
+};
+
+using KernelFunc = void (*)(const AttributeDesc *attrs, const char *buffer,
+                            size_t stride, size_t numVertices);
+
+// All attributes are decoded per vertex, conversions and output strides
+// are resolved at compile time
+template <class... Ops, size_t... I>
+void RunKernel(const AttributeDesc *attrs, const char *buffer, size_t stride,
+               size_t numVertices, std::index_sequence<I...>) {
+  const size_t offsets[]{attrs[I].offset...};
+  char *outputs[]{attrs[I].output...};
+
+  for (size_t v = 0; v < numVertices; v++, buffer += stride) {
+    (Ops::Run(buffer + offsets[I], outputs[I] + v * Ops::OUT_SIZE), ...);
+  }
+}
+
+template <class... Ops>
+void Kernel(const AttributeDesc *attrs, const char *buffer, size_t stride,
+            size_t numVertices) {
+  RunKernel<Ops...>(attrs, buffer, stride, numVertices,
+                    std::index_sequence_for<Ops...>{});
+}
+
+struct Specialization {
+  std::vector<std::pair<InputFormat, VertexFormat>> signature;
+  KernelFunc kernel;
+};
+
+template <class... Ops> Specialization Specialize() {
+  return {{{Ops::INPUT, Ops::OUTPUT}...}, Kernel<Ops...>};
+}
+
+constexpr VertexFormat DefaultFormat(InputFormat input, bool padded) {
+  switch (input) {
+  case InputFormat::None:
+    return VertexFormat::Skip;
+  case InputFormat::UInt8x4:
+    return VertexFormat::UInt8;
+  case InputFormat::UInt16:
+    return VertexFormat::UInt32;
+  default:
+    return padded ? VertexFormat::Float4 : VertexFormat::Float;
+  }
+}
+
+// Layout is specialized for default formats and for Float4 in place of Float
+template <InputFormat... I> void AddLayout(std::vector<Specialization> &specs) {
+  specs.emplace_back(Specialize<Op<I, DefaultFormat(I, false)>...>());
+  specs.emplace_back(Specialize<Op<I, DefaultFormat(I, true)>...>());
+}
+
+// Common layouts of XC2/XC3 model buffers
+const std::vector<Specialization> SPECIALIZATIONS = [] {
+  using enum InputFormat;
+  std::vector<Specialization> retVal;
+  AddLayout<Float3, UInt16, Float2, SNorm8x4, SNorm8x4>(retVal);
+  AddLayout<Float3, UInt16, Float2, Float2, SNorm8x4, SNorm8x4>(retVal);
+  AddLayout<Float3, UInt16, Float2, UInt8x4, SNorm8x4, SNorm8x4>(retVal);
+  AddLayout<Float3, UInt16, Float2, Float2, UInt8x4, SNorm8x4, SNorm8x4>(
+      retVal);
+  AddLayout<Float3, UInt16, Float2, Float2, Float2, UInt8x4, SNorm8x4,
+            SNorm8x4>(retVal);
+  AddLayout<Float3, UInt16, UInt8x4, SNorm8x4, SNorm8x4>(retVal);
+  AddLayout<UNorm16x4, UInt8x4>(retVal);
+
+  return retVal;
+}();
+} // namespace
+
+class VertexDecoderImpl {
+public:
+  std::vector<AttributeDesc> attributes;
+
+  KernelFunc FindKernel() const {
+    auto Matches = [&](const Specialization &spec) {
+      return std::equal(spec.signature.begin(), spec.signature.end(),
+                        attributes.begin(), attributes.end(),
+                        [](auto &sig, const AttributeDesc &attr) {
+                          return sig.first == attr.input &&
+                                 sig.second == attr.format;
+                        });
+    };
+
+    auto found = std::find_if(SPECIALIZATIONS.begin(), SPECIALIZATIONS.end(),
+                              Matches);
+
+    return found == SPECIALIZATIONS.end() ? nullptr : found->kernel;
+  }
+
+  void DecodeGeneric(const char *buffer, size_t stride,
+                     size_t numVertices) const {
+    struct Active {
+      size_t offset;
+      OpInfo op;
+      char *output;
+    };
+
+    std::vector<Active> active;
+
+    for (auto &a : attributes) {
+      if (a.format != VertexFormat::Skip) {
+        active.emplace_back(Active{
+            a.offset, OPS[size_t(a.input)][size_t(a.format)], a.output});
+      }
+    }
+
+    for (size_t v = 0; v < numVertices; v++, buffer += stride) {
+      for (auto &a : active) {
+        a.op.func(buffer + a.offset, a.output + v * a.op.outSize);
+      }
+    }
+  }
+};
+
+VertexDecoder::VertexDecoder(std::span<const VertexType> layout)
+    : pi(std::make_unique<VertexDecoderImpl>()) {
+  size_t curOffset = 0;
+
+  for (auto &d : layout) {
+    pi->attributes.emplace_back(
+        AttributeDesc{d, GetInputFormat(d.type), curOffset});
+    curOffset += d.size;
+  }
+}
+
+VertexDecoder::VertexDecoder(VertexDecoder &&) = default;
+VertexDecoder::~VertexDecoder() = default;
+
+VertexFormat VertexDecoder::DefaultFormat(VertexDescriptorType type) {
+  return MXMD::DefaultFormat(GetInputFormat(type), false);
+}
+
+size_t VertexDecoder::NumAttributes() const { return pi->attributes.size(); }
+
+VertexType VertexDecoder::Attribute(size_t index) const {
+  return pi->attributes.at(index).type;
+}
+
+size_t VertexDecoder::NumComponents(size_t index) const {
+  switch (pi->attributes.at(index).input) {
+  case InputFormat::None:
+    return 0;
+  case InputFormat::Float3:
+    return 3;
+  case InputFormat::Float2:
+    return 2;
+  case InputFormat::UInt16:
+    return 1;
+  default:
+    return 4;
+  }
+}
+
+int64 VertexDecoder::Find(VertexDescriptorType type) const {
+  auto found = std::find_if(pi->attributes.begin(), pi->attributes.end(),
+                            [type](auto &a) { return a.type.type == type; });
+
+  return found == pi->attributes.end()
+             ? -1
+             : std::distance(pi->attributes.begin(), found);
+}
+
+void VertexDecoder::SetOutput(size_t index, VertexFormat format,
+                              void *output) {
+  auto &attr = pi->attributes.at(index);
+
+  if (attr.input == InputFormat::None && format != VertexFormat::Skip) {
+    throw std::runtime_error("Unhandled vertex type");
+  }
+
+  attr.format = output ? format : VertexFormat::Skip;
+  attr.output = static_cast<char *>(output);
+}
+
+bool VertexDecoder::IsSpecialized() const { return pi->FindKernel(); }
+
+void VertexDecoder::Decode(const char *buffer, size_t stride,
+                           size_t numVertices) const {
+  if (KernelFunc kernel = pi->FindKernel()) {
+    kernel(pi->attributes.data(), buffer, stride, numVertices);
+  } else {
+    pi->DecodeGeneric(buffer, stride, numVertices);
+  }
+}
+} // namespace MXMD
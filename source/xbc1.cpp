@@ -20,6 +20,8 @@
 #include "zlib.h"
 #define ZSTD_DISABLE_DEPRECATE_WARNINGS
 #include "zstd.h"
+#include <algorithm>
+#include <memory>
 
 namespace {
 enum class CompType {
@@ -81,3 +83,116 @@ std::string DecompressXBC1(const char *data) {
 
   return retval;
 }
+
+std::string DecompressXBC1(const char *data, size_t offset, size_t size) {
+  auto *hdr = reinterpret_cast<const xbc1 *>(data);
+
+  if (hdr->id != xbc1::ID) {
+    throw es::InvalidHeaderError(hdr->id);
+  }
+
+  if (offset > hdr->uncompressedSize ||
+      size > hdr->uncompressedSize - offset) {
+    throw std::out_of_range("Decompression range is out of bounds");
+  }
+
+  std::string retval;
+  retval.resize(size);
+  // Bytes before range are decoded into scratch and discarded
+  char scratch[0x4000];
+
+  // fc(out, outSize) returns number of decoded bytes, 0 at end of stream
+  auto Decode = [&](auto &&fc) {
+    while (offset) {
+      const size_t decoded = fc(scratch, std::min(offset, sizeof(scratch)));
+
+      if (!decoded) {
+        throw std::runtime_error("Compressed stream ended prematurely");
+      }
+
+      offset -= decoded;
+    }
+
+    for (size_t done = 0; done < size;) {
+      const size_t decoded = fc(retval.data() + done, size - done);
+
+      if (!decoded) {
+        throw std::runtime_error("Compressed stream ended prematurely");
+      }
+
+      done += decoded;
+    }
+  };
+
+  if (hdr->compressionType == CompType::Zlib) {
+    z_stream strm{};
+    strm.next_in = reinterpret_cast<Bytef *>(const_cast<xbc1 *>(hdr + 1));
+    strm.avail_in = hdr->compressedSize;
+
+    if (inflateInit(&strm) != Z_OK) {
+      throw std::runtime_error("Zlib, inflate init failed");
+    }
+
+    std::unique_ptr<z_stream, decltype(&inflateEnd)> guard(&strm,
+                                                           inflateEnd);
+
+    Decode([&](char *out, size_t outSize) -> size_t {
+      strm.next_out = reinterpret_cast<Bytef *>(out);
+      strm.avail_out = outSize;
+
+      while (strm.avail_out) {
+        const int status = inflate(&strm, Z_NO_FLUSH);
+
+        // Z_BUF_ERROR: input is exhausted
+        if (status == Z_STREAM_END || status == Z_BUF_ERROR) {
+          break;
+        } else if (status != Z_OK) [[unlikely]] {
+          if (status == Z_MEM_ERROR) {
+            throw std::runtime_error("Zlib, not enough memory");
+          }
+
+          throw std::runtime_error("Zlib, data is corrupted");
+        }
+      }
+
+      return outSize - strm.avail_out;
+    });
+  } else if (hdr->compressionType == CompType::Zstd) {
+    std::unique_ptr<ZSTD_DStream, decltype(&ZSTD_freeDStream)> dstream(
+        ZSTD_createDStream(), ZSTD_freeDStream);
+
+    if (!dstream) {
+      throw std::runtime_error("ZSTD, not enough memory");
+    }
+
+    ZSTD_inBuffer input{hdr + 1, hdr->compressedSize, 0};
+
+    Decode([&](char *out, size_t outSize) -> size_t {
+      ZSTD_outBuffer output{out, outSize, 0};
+
+      while (output.pos < output.size) {
+        const size_t lastPos = output.pos;
+        const size_t status =
+            ZSTD_decompressStream(dstream.get(), &output, &input);
+
+        if (ZSTD_isError(status)) {
+          throw std::runtime_error("ZSTD, decompression failed: " +
+                                   std::string(ZSTD_getErrorName(status)));
+        }
+
+        // End of frame or no progress with exhausted input
+        if (!status ||
+            (input.pos == input.size && output.pos == lastPos)) {
+          break;
+        }
+      }
+
+      return output.pos;
+    });
+  } else {
+    throw std::runtime_error("invalid compression type: " +
+                             std::to_string(uint32(hdr->compressionType)));
+  }
+
+  return retval;
+}
@@ -20,16 +20,60 @@
 #include "spike/app_context.hpp"
 #include "spike/except.hpp"
 #include "spike/io/binreader_stream.hpp"
+#include "spike/master_printer.hpp"
 #include "spike/reflect/reflector.hpp"
 #include "spike/util/endian.hpp"
+#include "json_writer.hpp"
+#include "worker_pool.hpp"
+#include "xxhash.hpp"
 #include "xenolib/bdat.hpp"
+#include "xenolib/bdat/columnar.hpp"
+#include "xenolib/bdat/hash_dictionary.hpp"
+#include "xenolib/bdat/query.hpp"
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <numeric>
 
 static struct BDAT2JSON : ReflectorBase<BDAT2JSON> {
   bool extract = true;
+  bool incremental = false;
+  bool columnar = false;
+  std::string query;
+  std::string search;
+  std::string select;
+  std::string hashNames;
 } settings;
 
-REFLECT(CLASS(BDAT2JSON),
-        MEMBER(extract, "E", ReflDesc{"Extract by data entry if possible."}), );
+REFLECT(
+    CLASS(BDAT2JSON),
+    MEMBER(extract, "E", ReflDesc{"Extract by data entry if possible."}),
+    MEMBER(incremental, "I",
+           ReflDesc{"Export only data entries that changed since previous "
+                    "export. Content hashes are kept in .manifest.json next "
+                    "to input. Previous output must stay in place, delete "
+                    "manifest when output folder changes. Archive output, "
+                    "new tool version or changed settings, including "
+                    "contents of hash name list, export everything."}),
+    MEMBER(columnar, "C",
+           ReflDesc{"Export whole file into binary columnar .bdcl file "
+                    "instead of JSON. Format is described in "
+                    "xenolib/bdat/columnar.hpp."}),
+    MEMBER(query, "q",
+           ReflDesc{"Output only rows matching all semicolon separated "
+                    "predicates into .query.jsonl. Example: "
+                    "Price>=100;Name~=Sword. Operators: == != < <= > >= "
+                    "~= (contains)."}),
+    MEMBER(search, "S",
+           ReflDesc{"Output string cells containing given text into "
+                    ".search.jsonl."}),
+    MEMBER(select, "s",
+           ReflDesc{"Comma separated list of columns to output for query "
+                    "matches. Outputs all columns when empty."}),
+    MEMBER(hashNames, "H",
+           ReflDesc{"Path to text file with one name per line. Used to "
+                    "resolve hashed V4 table names, column names and "
+                    "KeyHash values."}), );
 
 std::string_view filters[]{
     ".bdat$",
@@ -45,17 +89,427 @@ static AppInfo_s appInfo{
 
 AppInfo_s *AppInitModule() { return &appInfo; }
 
+struct QuerySettings {
+  std::vector<BDAT::Predicate> predicates;
+  std::vector<std::string> select;
+};
+
+// Parsed once, shared by all processed files
+static const QuerySettings &GetQuery() {
+  static const QuerySettings query = [] {
+    QuerySettings retVal;
+    auto Split = [](std::string_view str, char delim, auto &&cb) {
+      while (!str.empty()) {
+        const size_t found = str.find(delim);
+        std::string_view item = str.substr(0, found);
+
+        if (!item.empty()) {
+          cb(item);
+        }
+
+        if (found == str.npos) {
+          break;
+        }
+
+        str.remove_prefix(found + 1);
+      }
+    };
+
+    Split(settings.query, ';', [&](std::string_view item) {
+      retVal.predicates.emplace_back(BDAT::ParsePredicate(item));
+    });
+    Split(settings.select, ',',
+          [&](std::string_view item) { retVal.select.emplace_back(item); });
+
+    return retVal;
+  }();
+
+  return query;
+}
+
+struct HashNames {
+  BDAT::HashDictionary dictionary;
+  // Hash of name list contents, 0 when not used
+  uint64 contentHash = 0;
+};
+
+// Loaded once, shared by all processed files
+static const HashNames &LoadHashNames(AppContext *ctx) {
+  static const HashNames names = [ctx] {
+    HashNames retVal;
+
+    if (settings.hashNames.empty()) {
+      return retVal;
+    }
+
+    AppContextStream stream = ctx->RequestFile(settings.hashNames);
+    std::string nameList(std::istreambuf_iterator<char>(*stream.Get()), {});
+    retVal.dictionary.Load(nameList);
+    retVal.contentHash = HashBytes(nameList);
+    printinfo("Loaded " << retVal.dictionary.Size() << " hash names.");
+
+    return retVal;
+  }();
+
+  return names;
+}
+
+static const BDAT::HashDictionary &GetHashNames(AppContext *ctx) {
+  return LoadHashNames(ctx).dictionary;
+}
+
+struct IncrementalState {
+  std::vector<size_t> pending;
+  nlohmann::json manifest;
+};
+
+// Read and written next to input, output location is not known here
+static std::string ManifestPath(AppContext *ctx) {
+  return ctx->workingFile.ChangeExtension(".manifest.json");
+}
+
+// Hash of every setting that changes exported data entries
+static std::string SettingsHash(AppContext *ctx, bool extractDatas) {
+  const uint64 seed = LoadHashNames(ctx).contentHash;
+  char hash[0x20]{};
+  snprintf(hash, sizeof(hash), "%016" PRIX64,
+           HashBytes(extractDatas ? "extract" : "single", seed));
+
+  return hash;
+}
+
+// Collects data entries whose content hash differs from previous manifest.
+// Everything is pending when tool version or output settings differ.
+// extractDatas: unchanged entries are not sent again, their previous outputs
+// must persist.
+template <class C, class N>
+IncrementalState Incremental(AppContext *ctx, C &col, bool extractDatas,
+                             N &&outputName) {
+  IncrementalState retVal;
+  bool incremental = settings.incremental;
+
+  if (incremental && extractDatas &&
+      !ctx->ExtractContext()->RequiresFolders()) {
+    printwarning("Incremental export requires output into folder, exporting "
+                 "everything.");
+    incremental = false;
+  }
+
+  if (!incremental) {
+    retVal.pending.resize(col.NumDatas());
+    std::iota(retVal.pending.begin(), retVal.pending.end(), 0);
+    return retVal;
+  }
+
+  const std::string settingsHash = SettingsHash(ctx, extractDatas);
+  nlohmann::json previous;
+
+  if (std::ifstream str(ManifestPath(ctx)); str) {
+    try {
+      nlohmann::json manifest = nlohmann::json::parse(str);
+
+      if (manifest.value("version", "") == BDAT2JSON_VERSION &&
+          manifest.value("settings", "") == settingsHash) {
+        previous = std::move(manifest["datas"]);
+      } else {
+        printinfo("Tool version or settings changed, exporting everything.");
+      }
+    } catch (const nlohmann::json::exception &e) {
+      printwarning("Invalid manifest, exporting everything: " << e.what());
+    }
+  }
+
+  retVal.manifest = {
+      {"version", BDAT2JSON_VERSION},
+      {"settings", settingsHash},
+      {"datas", nlohmann::json::object()},
+  };
+  nlohmann::json &datas = retVal.manifest["datas"];
+  col.ComputeHashes();
+
+  for (size_t i = 0; i < col.NumDatas(); i++) {
+    char hash[0x20]{};
+    snprintf(hash, sizeof(hash), "%016" PRIX64, col.DataHash(i));
+    std::string name(outputName(i));
+
+    if (!previous.is_object() || !previous.contains(name) ||
+        previous[name] != hash) {
+      retVal.pending.push_back(i);
+    }
+
+    datas[name] = hash;
+  }
+
+  if (retVal.pending.size() < col.NumDatas()) {
+    printinfo("Skipping " << col.NumDatas() - retVal.pending.size()
+                          << " unchanged data entries.");
+  }
+
+  return retVal;
+}
+
+// Written after successful export only
+void SaveManifest(AppContext *ctx, const IncrementalState &state) {
+  if (state.manifest.is_null()) {
+    return;
+  }
+
+  const std::string path = ManifestPath(ctx);
+  std::ofstream str(path);
+  str << std::setw(2) << state.manifest;
+
+  if (!str) {
+    throw std::runtime_error("Cannot write manifest: " + path);
+  }
+}
+
+namespace BDAT {
+nlohmann::json ToJSON(const Cell &cell, const HashDictionary &names) {
+  switch (cell.type) {
+  case DataType::StringPtr:
+    return cell.asString ? cell.asString : "";
+  case DataType::Float:
+    return cell.asFloat;
+  case DataType::KeyHash: {
+    if (std::string_view name = names.Find(cell.asInt); !name.empty()) {
+      return name;
+    }
+
+    char data[0x10]{};
+    snprintf(data, sizeof(data), "%" PRIX32, uint32(cell.asInt));
+    return data;
+  }
+  default:
+    return cell.asInt;
+  }
+}
+
+// Table view with hashed column names resolved
+template <class H>
+TableView MakeView(const H &hdr, const HashDictionary &names) {
+  TableView retVal(hdr);
+
+  if (names.Size()) {
+    for (auto &c : retVal.columns) {
+      c.name = names.Resolve(c.name);
+    }
+  }
+
+  return retVal;
+}
+
+// Scans tables on worker pool, fc(table, index) returns json lines.
+// Output file is created on first non empty result.
+template <class C, class F>
+void WriteLines(AppContext *ctx, const C &col, std::string_view extension,
+                F &&fc) {
+  std::ostream *str = nullptr;
+  const HashDictionary &names = GetHashNames(ctx);
+
+  ParallelOrdered(
+      col.NumDatas(),
+      [&](size_t index) { return fc(MakeView(col.Get(index), names), index); },
+      [&](size_t, std::string result) {
+        if (result.empty()) {
+          return;
+        }
+
+        if (!str) {
+          str = &ctx->NewFile(ctx->workingFile.ChangeExtension(extension)).str;
+        }
+
+        *str << result;
+      });
+}
+
+template <class C, class N>
+void Query(AppContext *ctx, const C &col, N &&tableName) {
+  const QuerySettings &query = GetQuery();
+  const HashDictionary &names = GetHashNames(ctx);
+
+  WriteLines(ctx, col, ".query.jsonl", [&](const TableView &table,
+                                            size_t index) {
+    std::string result;
+    std::vector<const ColumnView *> columns;
+
+    if (query.select.empty()) {
+      for (auto &c : table.columns) {
+        columns.push_back(&c);
+      }
+    } else {
+      for (auto &c : query.select) {
+        if (auto found = table.FindColumn(c)) {
+          columns.push_back(found);
+        }
+      }
+    }
+
+    for (size_t row : FindRows(table, query.predicates)) {
+      nlohmann::json line{{"table", tableName(index)}, {"row", row}};
+      auto &values = line["values"] = nlohmann::json::object();
+
+      for (auto c : columns) {
+        values[c->name] = ToJSON(table.Get(row, *c), names);
+      }
+
+      result.append(line.dump());
+      result.push_back('\n');
+    }
+
+    return result;
+  });
+}
+
+template <class C, class N>
+void Search(AppContext *ctx, const C &col, N &&tableName) {
+  WriteLines(ctx, col, ".search.jsonl", [&](const TableView &table,
+                                             size_t index) {
+    std::string result;
+
+    for (auto &hit : FindString(table, settings.search)) {
+      nlohmann::json line{{"table", tableName(index)},
+                          {"row", hit.row},
+                          {"column", hit.column->name},
+                          {"value", hit.value}};
+      result.append(line.dump());
+      result.push_back('\n');
+    }
+
+    return result;
+  });
+}
+
+template <class C, class N, class K>
+void ExportColumnar(AppContext *ctx, const C &col, N &&tableName,
+                    K &&tableKeys) {
+  Columnar::Writer writer;
+  const HashDictionary &names = GetHashNames(ctx);
+
+  for (size_t i = 0; i < col.NumDatas(); i++) {
+    auto hdr = col.Get(i);
+    writer.AddTable(tableName(i), MakeView(hdr, names), tableKeys(hdr));
+  }
+
+  ctx->NewFile(ctx->workingFile.ChangeExtension(".bdcl")).str
+      << writer.Build();
+}
+
+static constexpr size_t ROWS_PER_CHUNK = 256;
+
+struct RowChunk {
+  size_t table;
+  size_t begin;
+  size_t end;
+  size_t numRows;
+};
+
+// Data entries are rendered in chunks of rows on worker pool and passed
+// into sink(chunk, rows) in order. Only few chunks are held at once, so
+// memory does not grow with size of data entries.
+// depth: indentation level of data entry in output
+// writeRows(hdr, begin, end, wr) writes rows as array elements
+template <class C, class W, class S>
+void StreamRows(const C &col, const std::vector<size_t> &tables,
+                size_t depth, W &&writeRows, S &&sink) {
+  ParallelFor(tables.size(), [&](size_t index) { col.Get(tables[index]); });
+  std::vector<RowChunk> chunks;
+
+  for (size_t t : tables) {
+    const size_t numRows = NumRows(col.Get(t));
+    size_t begin = 0;
+
+    do {
+      const size_t end = std::min(begin + ROWS_PER_CHUNK, numRows);
+      chunks.push_back({t, begin, end, numRows});
+      begin = end;
+    } while (begin < numRows);
+  }
+
+  ParallelOrdered(
+      chunks.size(),
+      [&](size_t index) {
+        const RowChunk &chunk = chunks[index];
+        JSONWriter wr(nullptr, depth);
+        wr.Resume(chunk.begin > 0);
+        writeRows(col.Get(chunk.table), chunk.begin, chunk.end, wr);
+        return std::move(wr.Buffer());
+      },
+      [&](size_t index, std::string rows) { sink(chunks[index], rows); });
+}
+
+// Streamed rows are framed as array, data entry without rows is null
+void WriteChunk(JSONWriter &wr, const RowChunk &chunk, std::string_view rows) {
+  if (!chunk.numRows) {
+    wr.Null();
+    return;
+  }
+
+  if (!chunk.begin) {
+    wr.BeginArray();
+  }
+
+  wr.RawElements(rows);
+
+  if (chunk.end == chunk.numRows) {
+    wr.EndArray();
+  }
+}
+
+// Writes pending data entries into file per data entry,
+// or every data entry into single file.
+template <class C, class W, class N>
+void WriteDatas(AppContext *ctx, const C &col,
+                const std::vector<size_t> &pending, bool extractDatas,
+                W &&writeRows, N &&dataName) {
+  if (extractDatas) {
+    auto ectx = ctx->ExtractContext();
+    JSONWriter wr;
+
+    StreamRows(col, pending, 0, writeRows,
+               [&](const RowChunk &chunk, std::string_view rows) {
+                 if (!chunk.begin) {
+                   ectx->NewFile(dataName(chunk.table) + ".json");
+                 }
+
+                 WriteChunk(wr, chunk, rows);
+                 ectx->SendData(wr.Buffer());
+                 wr.Buffer().clear();
+               });
+  } else {
+    std::vector<size_t> tables(col.NumDatas());
+    std::iota(tables.begin(), tables.end(), 0);
+    JSONWriter wr(
+        &ctx->NewFile(ctx->workingFile.ChangeExtension(".json")).str);
+    wr.BeginObject();
+
+    StreamRows(col, tables, 1, writeRows,
+               [&](const RowChunk &chunk, std::string_view rows) {
+                 if (!chunk.begin) {
+                   wr.Key(dataName(chunk.table));
+                 }
+
+                 WriteChunk(wr, chunk, rows);
+               });
+
+    wr.EndObject();
+  }
+}
+} // namespace BDAT
+
 namespace BDAT::V1 {
-nlohmann::json ToJSON(const Header *hdr) {
-  nlohmann::json jk;
+size_t NumRows(const Header *hdr) { return hdr->numKeyValues; }
+
+// Writes rows [begin, end) as array elements
+void ToJSON(const Header *hdr, JSONWriter &wr, size_t begin, size_t end) {
   const char *values = hdr->keyValues;
   const KeyDesc *keyDescs = hdr->keyDescs;
   struct Flag {
     std::string_view name;
-    uint16 index;
     uint16 value;
   };
   std::map<const KeyDesc *, std::vector<Flag>> flags;
+  // Columns are written in name order
+  std::vector<const KeyDesc *> columns;
 
   for (uint16 k = 0; k < hdr->numKeyDescs; k++) {
     auto &cDesc = keyDescs[k];
@@ -63,268 +517,333 @@ nlohmann::json ToJSON(const Header *hdr) {
 
     if (kDesc->baseType == BaseType::Flag) {
       auto &flagType = *static_cast<const FlagTypeDesc *>(kDesc);
-      Flag flg;
-      flg.name = cDesc.name.Get();
-      flg.index = flagType.index;
-      flg.value = flagType.value;
-
       const KeyDesc *key = flagType.belongsTo;
-
-      if (flags.contains(key)) {
-        flags.at(key).emplace_back(flg);
-      } else {
-        flags.emplace(key, std::vector<Flag>{flg});
-      }
+      flags[key].emplace_back(Flag{cDesc.name.Get(), flagType.value});
+    } else if (kDesc->baseType != BaseType::None) {
+      columns.push_back(&cDesc);
     }
   }
 
-  for (uint16 b = 0; b < hdr->numKeyValues; b++) {
-    const char *block = values + hdr->kvBlockStride * b;
-    nlohmann::json kvBlock;
+  for (auto &[_, f] : flags) {
+    std::sort(f.begin(), f.end(), [](auto &a, auto &b) {
+      return a.name < b.name;
+    });
+  }
 
-    for (uint16 k = 0; k < hdr->numKeyDescs; k++) {
-      auto &cDesc = keyDescs[k];
-      const BaseTypeDesc *kDesc = cDesc.typeDesc;
+  std::stable_sort(columns.begin(), columns.end(), [](auto a, auto b) {
+    return std::string_view(a->name.Get()) < b->name.Get();
+  });
+
+  auto WriteFlags = [&wr](auto &flags, const Value *bVal, DataType type) {
+    uint32 data;
+    switch (type) {
+    case DataType::i8:
+      data = bVal->asI8;
+      break;
+    case DataType::i16:
+      data = bVal->asI16;
+      break;
+    case DataType::i32:
+      data = bVal->asI32;
+      break;
+    case DataType::u8:
+      data = bVal->asU8;
+      break;
+    case DataType::u16:
+      data = bVal->asU16;
+      break;
+    case DataType::u32:
+      data = bVal->asU32;
+      break;
+    default:
+      throw std::runtime_error("Invalid flag type");
+    }
 
-      auto SetFlags = [](auto &flags, const Value *bVal, DataType type) {
-        uint32 data;
-        switch (type) {
-        case DataType::i8:
-          data = bVal->asI8;
-          break;
-        case DataType::i16:
-          data = bVal->asI16;
-          break;
-        case DataType::i32:
-          data = bVal->asI32;
-          break;
-        case DataType::u8:
-          data = bVal->asU8;
-          break;
-        case DataType::u16:
-          data = bVal->asU16;
-          break;
-        case DataType::u32:
-          data = bVal->asU32;
-          break;
-        default:
-          throw std::runtime_error("Invalid flag type");
-        }
+    wr.BeginObject();
 
-        std::map<std::string_view, bool> flagDict;
+    for (const Flag &f : flags) {
+      wr.Field(f.name, (data & f.value) != 0);
+    }
 
-        for (Flag &f : flags) {
-          flagDict.emplace(f.name, data & f.value);
-        }
+    wr.EndObject();
+  };
 
-        auto retVal = nlohmann::json{flagDict};
+  for (size_t b = begin; b < end; b++) {
+    const char *block = values + hdr->kvBlockStride * b;
+    wr.BeginObject();
 
-        return retVal.is_array() ? retVal.back() : retVal;
-      };
+    for (const KeyDesc *cDesc : columns) {
+      const BaseTypeDesc *kDesc = cDesc->typeDesc;
+      auto &valueType = *static_cast<const TypeDesc *>(kDesc);
+      auto foundFlags = flags.find(cDesc);
 
-      auto SetValue = [&](nlohmann::json &at, size_t offset = 0) {
-        auto &valueType = *static_cast<const TypeDesc *>(kDesc);
+      auto WriteValue = [&](size_t offset = 0) {
         auto bVal =
             reinterpret_cast<const Value *>(block + valueType.offset + offset);
 
-        if (flags.contains(&cDesc)) {
-          at = SetFlags(flags.at(&cDesc), bVal, valueType.type);
+        if (foundFlags != flags.end()) {
+          WriteFlags(foundFlags->second, bVal, valueType.type);
           return;
         }
 
         switch (valueType.type) {
         case DataType::i8:
-          at = bVal->asI8;
+          wr.Value(bVal->asI8);
           break;
         case DataType::i16:
-          at = bVal->asI16;
+          wr.Value(bVal->asI16);
           break;
         case DataType::i32:
-          at = bVal->asI32;
+          wr.Value(bVal->asI32);
           break;
         case DataType::u8:
-          at = bVal->asU8;
+          wr.Value(bVal->asU8);
           break;
         case DataType::u16:
-          at = bVal->asU16;
+          wr.Value(bVal->asU16);
           break;
         case DataType::u32:
-          at = bVal->asU32;
+          wr.Value(bVal->asU32);
           break;
         case DataType::StringPtr:
-          at = bVal->asString.Get();
+          wr.Value(bVal->asString.Get());
           break;
         case DataType::Float:
-          at = bVal->asFloat;
+          wr.Value(bVal->asFloat);
           break;
 
         default:
+          wr.Null();
           break;
         }
       };
 
-      switch (kDesc->baseType) {
-      case BaseType::Default:
-        SetValue(kvBlock[cDesc.name.Get()]);
-      case BaseType::Flag:
-      case BaseType::None:
-        break;
+      wr.Key(cDesc->name.Get());
 
-      case BaseType::Array: {
-        auto &jv = kvBlock[cDesc.name.Get()];
-        auto &valueType = *static_cast<const ArrayTypeDesc *>(kDesc);
-        size_t typeLen = BDAT::TypeSize(valueType.type);
+      if (kDesc->baseType == BaseType::Default) {
+        WriteValue();
+      } else {
+        auto &arrayType = *static_cast<const ArrayTypeDesc *>(kDesc);
+        const size_t typeLen = BDAT::TypeSize(arrayType.type);
 
-        for (uint16 a = 0; a < valueType.numItems; a++) {
-          nlohmann::json cjVal;
-          SetValue(cjVal, a * typeLen);
-          jv.emplace_back(cjVal);
+        if (!arrayType.numItems) {
+          wr.Null();
+          continue;
         }
-      }
+
+        wr.BeginArray();
+
+        for (uint16 a = 0; a < arrayType.numItems; a++) {
+          WriteValue(a * typeLen);
+        }
+
+        wr.EndArray();
       }
     }
 
-    jk.emplace_back(std::move(kvBlock));
+    wr.EndObject();
   }
-
-  return jk;
 }
 
 void Extract(AppContext *ctx) {
-  {
-    Collection col;
-    ctx->GetType(col);
+  LazyCollection col;
+  col.Load(ctx->GetBuffer());
 
-    if (col.numDatas > 0x10000) {
-      FByteswapper(col);
-      FByteswapper(col.datas);
-    }
+  if (!settings.query.empty()) {
+    Query(ctx, col, [&col](size_t index) { return col.DataName(index); });
+    return;
+  }
 
-    uint32 bdatId;
-    ctx->GetType(bdatId, col.datas[0]);
+  if (!settings.search.empty()) {
+    Search(ctx, col, [&col](size_t index) { return col.DataName(index); });
+    return;
+  }
 
-    if (bdatId != BDAT::ID) {
-      throw es::InvalidHeaderError(bdatId);
-    }
+  if (settings.columnar) {
+    ExportColumnar(
+        ctx, col, [&col](size_t index) { return col.DataName(index); },
+        [](const Header *) { return std::span<const V4::Key>{}; });
+    return;
   }
 
-  std::string buffer = ctx->GetBuffer();
-  Collection &col = reinterpret_cast<BDAT::V1::Collection &>(*buffer.data());
-  ProcessClass(col);
+  const bool extractDatas = settings.extract && col.NumDatas() > 1;
+  IncrementalState state =
+      Incremental(ctx, col, extractDatas, [&](size_t index) {
+        return extractDatas ? std::string(col.DataName(index)) + ".json"
+                            : std::string(col.DataName(index));
+      });
 
-  if (settings.extract && col.numDatas > 1) {
-    auto ectx = ctx->ExtractContext();
-    for (auto &d : col) {
-      const Header *hdr = d;
-      ectx->NewFile(hdr->name.Get() + std::string(".json"));
-      auto dumped = ToJSON(hdr).dump(2, ' ');
-      ectx->SendData(dumped);
-    }
-  } else {
-    auto &strWr = ctx->NewFile(ctx->workingFile.ChangeExtension(".json")).str;
-    strWr << "{\n";
-
-    for (auto &d : col) {
-      const Header *hdr = d;
-      strWr << "\"";
-      strWr << hdr->name.Get();
-      strWr << "\": ";
-      strWr << std::setw(2) << ToJSON(hdr);
-    }
+  if (state.pending.empty()) {
+    return;
   }
+
+  WriteDatas(
+      ctx, col, state.pending, extractDatas,
+      [](const Header *hdr, size_t begin, size_t end, JSONWriter &wr) {
+        ToJSON(hdr, wr, begin, end);
+      },
+      [&](size_t index) { return std::string(col.DataName(index)); });
+
+  SaveManifest(ctx, state);
 }
 } // namespace BDAT::V1
 
 namespace BDAT::V4 {
-nlohmann::json ToJSON(const Header *hdr) {
-  nlohmann::json jk;
+size_t NumRows(const Header *hdr) { return hdr->numKeys; }
+
+// Writes rows [begin, end) as array elements
+void ToJSON(const Header *hdr, JSONWriter &wr, size_t begin, size_t end,
+            const HashDictionary &names) {
   const char *values = hdr->values;
   const Descriptor *descs = hdr->descriptors;
 
-  for (uint16 b = 0; b < hdr->numKeys; b++) {
+  for (size_t b = begin; b < end; b++) {
     const char *block = values + hdr->kvBlockSize * b;
     size_t curOffset = 0;
-    nlohmann::json kvBlock;
 
-    for (uint16 k = 0; k < hdr->numDescs; k++) {
-      auto &cDesc = descs[k];
+    if (!hdr->numDescs) {
+      wr.Null();
+      continue;
+    }
 
-      auto SetValue = [&](nlohmann::json &at, size_t offset = 0) {
-        auto bVal = reinterpret_cast<const Value *>(block + curOffset + offset);
+    wr.BeginArray();
 
-        switch (cDesc.type) {
-        case DataType::i8:
-          at = bVal->asI8;
-          break;
-        case DataType::i16:
-          at = bVal->asI16;
-          break;
-        case DataType::i32:
-          at = bVal->asI32;
-          break;
-        case DataType::u8:
-          at = bVal->asU8;
-          break;
-        case DataType::u16:
-        case DataType::Unk1:
-          at = bVal->asU16;
-          break;
-        case DataType::u32:
-        case DataType::Unk:
-          at = bVal->asU32;
-          break;
-        case DataType::StringPtr:
-          at = bVal->asString.Get();
-          break;
-        case DataType::Float:
-          at = bVal->asFloat;
-          break;
-        case DataType::KeyHash: {
-          char data[0x10]{};
-          snprintf(data, sizeof(data), "%" PRIX32, bVal->asU32);
-          at = data;
-          break;
-        }
-        default:
+    for (uint32 k = 0; k < hdr->numDescs; k++) {
+      auto &cDesc = descs[k];
+      auto bVal = reinterpret_cast<const Value *>(block + curOffset);
+
+      switch (cDesc.type) {
+      case DataType::i8:
+        wr.Value(bVal->asI8);
+        break;
+      case DataType::i16:
+        wr.Value(bVal->asI16);
+        break;
+      case DataType::i32:
+        wr.Value(bVal->asI32);
+        break;
+      case DataType::u8:
+        wr.Value(bVal->asU8);
+        break;
+      case DataType::u16:
+      case DataType::Unk1:
+        wr.Value(bVal->asU16);
+        break;
+      case DataType::u32:
+      case DataType::Unk:
+        wr.Value(bVal->asU32);
+        break;
+      case DataType::StringPtr:
+        wr.Value(bVal->asString.Get());
+        break;
+      case DataType::Float:
+        wr.Value(bVal->asFloat);
+        break;
+      case DataType::KeyHash: {
+        if (std::string_view name = names.Find(bVal->asU32); !name.empty()) {
+          wr.Value(name);
           break;
         }
-      };
 
-      SetValue(kvBlock[k]);
+        char data[0x10]{};
+        snprintf(data, sizeof(data), "%" PRIX32, bVal->asU32);
+        wr.Value(data);
+        break;
+      }
+      default:
+        wr.Null();
+        break;
+      }
+
       curOffset += BDAT::TypeSize(cDesc.type);
     }
 
-    jk.emplace_back(std::move(kvBlock));
+    wr.EndArray();
   }
-
-  return jk;
 }
 
-void Extract(AppContext *ctx) {
-  std::string buffer = ctx->GetBuffer();
-  Collection &col = reinterpret_cast<Collection &>(*buffer.data());
-  ProcessClass(col, {});
+// Resolved table name if known, index otherwise
+std::string DataName(std::string_view name, size_t index,
+                     const HashDictionary &names) {
+  if (names.Size()) {
+    std::string resolved = names.Resolve(name);
 
-  if (settings.extract && col.numDatas > 1) {
-    auto ectx = ctx->ExtractContext();
-    for (size_t cid = 0; auto &d : col) {
-      const Header *hdr = d;
-      ectx->NewFile(std::to_string(cid++) + std::string(".json"));
-      auto dumped = ToJSON(hdr).dump(2, ' ');
-      ectx->SendData(dumped);
+    if (!resolved.empty() && !resolved.starts_with('<')) {
+      return resolved;
     }
+  }
+
+  return std::to_string(index);
+}
+
+// Read-only modes never process data entries.
+// Input is mapped when it's a file on disk, instead of being read whole.
+void ExtractView(AppContext *ctx) {
+  const std::string path(ctx->workingFile.GetFullPath());
+  std::string buffer;
+  CollectionView col;
+
+  if (std::filesystem::is_regular_file(path)) {
+    col = CollectionView::Map(path);
   } else {
-    auto &strWr = ctx->NewFile(ctx->workingFile.ChangeExtension(".json")).str;
-    strWr << "{\n";
-
-    for (auto &d : col) {
-      const Header *hdr = d;
-      strWr << "\"";
-      strWr << ctx->workingFile.GetFilename();
-      strWr << "\": ";
-      strWr << std::setw(2) << ToJSON(hdr);
-    }
+    buffer = ctx->GetBuffer();
+    col = CollectionView(buffer);
   }
+
+  const HashDictionary &names = GetHashNames(ctx);
+  auto ViewName = [&](size_t index) {
+    return DataName(col.Get(index).Name(), index, names);
+  };
+
+  auto TableName = [&](size_t index) {
+    return std::string(ctx->workingFile.GetFilename()) + ':' +
+           ViewName(index);
+  };
+
+  if (!settings.query.empty()) {
+    Query(ctx, col, TableName);
+  } else if (!settings.search.empty()) {
+    Search(ctx, col, TableName);
+  } else {
+    ExportColumnar(ctx, col, ViewName, [](const DataView &view) {
+      return std::span<const Key>(view.Keys(), view.NumRows());
+    });
+  }
+}
+
+void Extract(AppContext *ctx) {
+  if (!settings.query.empty() || !settings.search.empty() ||
+      settings.columnar) {
+    ExtractView(ctx);
+    return;
+  }
+
+  LazyCollection col;
+  col.Load(ctx->GetBuffer());
+  const HashDictionary &names = GetHashNames(ctx);
+
+  auto DataName = [&](size_t index) {
+    return V4::DataName(col.DataName(index), index, names);
+  };
+
+  const bool extractDatas = settings.extract && col.NumDatas() > 1;
+  IncrementalState state =
+      Incremental(ctx, col, extractDatas, [&](size_t index) {
+        return extractDatas ? DataName(index) + ".json" : DataName(index);
+      });
+
+  if (state.pending.empty()) {
+    return;
+  }
+
+  WriteDatas(
+      ctx, col, state.pending, extractDatas,
+      [&](const Header *hdr, size_t begin, size_t end, JSONWriter &wr) {
+        ToJSON(hdr, wr, begin, end, names);
+      },
+      DataName);
+
+  SaveManifest(ctx, state);
 }
 } // namespace BDAT::V4
 
@@ -340,7 +859,8 @@ void AppProcessFile(AppContext *ctx) {
 }
 
 size_t AppExtractStat(request_chunk requester) {
-  if (!settings.extract) {
+  if (!settings.extract || settings.columnar || !settings.query.empty() ||
+      !settings.search.empty()) {
     return 1;
   }
   auto data = requester(0, 16);
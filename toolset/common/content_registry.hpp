@@ -0,0 +1,99 @@
+/*  xenoblade_toolset common code
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "spike/app_context.hpp"
+#include "xxhash.hpp"
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+/*
+Process wide registry of payloads seen during batch run, keyed by content
+digest. First file to claim payload owns it and processes it, every later
+file with identical bytes gets owner location to refer to instead.
+Payloads are identified by size and 128 bit digest (XXH64 with two seeds),
+only owner locations are kept, so memory doesn't grow with payload sizes.
+
+  static ContentRegistry registry;
+  const std::string owner = ContentOwner(ctx, "payload.bin");
+
+  if (auto original = registry.Claim(payload, owner)) {
+    ectx->NewFile("payload.bin.ref");
+    ectx->SendData(ContentReference(ctx, *original));
+  } else {
+    Process(payload);
+  }
+
+Safe to call from multiple AppProcessFile threads.
+*/
+
+class ContentRegistry {
+public:
+  // Returns owner of identical payload, or nullopt when caller is its owner
+  std::optional<std::string> Claim(std::string_view data,
+                                   std::string_view owner) {
+    Key key{HashBytes(data), HashBytes(data, SECOND_SEED), data.size()};
+    std::lock_guard lock(mutex);
+    auto [it, inserted] = owners.try_emplace(key, owner);
+
+    if (inserted) {
+      return std::nullopt;
+    }
+
+    return it->second;
+  }
+
+private:
+  static constexpr uint64 SECOND_SEED = 0x9E3779B97F4A7C15;
+
+  struct Key {
+    uint64 hash0;
+    uint64 hash1;
+    size_t size;
+
+    bool operator==(const Key &) const = default;
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const { return key.hash0; }
+  };
+
+  std::mutex mutex;
+  std::unordered_map<Key, std::string, KeyHash> owners;
+};
+
+// Location of extracted file, extract folders mirror input layout and are
+// named after input without extension
+inline std::string ContentOwner(AppContext *ctx, std::string_view name) {
+  return std::string(ctx->workingFile.GetFullPathNoExt()) + '/' +
+         std::string(name);
+}
+
+// Body of reference file, written in place of deduplicated payload.
+// Owner is relative to folder of reference file, so it stays valid
+// wherever output is placed.
+inline std::string ContentReference(AppContext *ctx, std::string_view owner) {
+  namespace fs = std::filesystem;
+  const fs::path folder(ctx->workingFile.GetFullPathNoExt());
+  const fs::path relative = fs::path(owner).lexically_relative(folder);
+
+  return "Identical to: " + relative.generic_string() + '\n';
+}
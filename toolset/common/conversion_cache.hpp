@@ -0,0 +1,303 @@
+/*  xenoblade_toolset common code
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "spike/app_context.hpp"
+#include "spike/except.hpp"
+#include "spike/master_printer.hpp"
+#include "spike/util/supercore.hpp"
+#include "xxhash.hpp"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+
+/*
+Opt-in cache of converted outputs, keyed by hash of input bytes,
+working file name, converter version and settings.
+
+  ConversionCache cache(ctx, settings.cacheDir, "mdo_to_gltf", VERSION);
+  cache.HashStream(ctx->GetStream());
+  cache.HashFile(companionPath);
+  cache.Hash(settings.someOption);
+
+  if (cache.Restore()) {
+    return;
+  }
+
+  Convert(cache.NewFile(".glb"));
+  cache.Finish();
+*/
+
+class ConversionCache {
+public:
+  // Empty cacheDir disables cache, every output is then written directly
+  ConversionCache(AppContext *ctx_, std::string_view cacheDir,
+                  std::string_view converter, std::string_view version)
+      : ctx(ctx_), folder(cacheDir), converterName(converter) {
+    Hash(converter);
+    Hash(version);
+    // Outputs may refer to files named after working file
+    Hash(ctx->workingFile.GetFilenameExt());
+  }
+
+  bool Enabled() const { return !folder.empty(); }
+
+  void Hash(std::string_view data) {
+    if (Enabled()) {
+      key = HashBytes(data, key ^ data.size());
+    }
+  }
+
+  template <class T>
+    requires std::is_arithmetic_v<T>
+  void Hash(T value) {
+    Hash(std::string_view(reinterpret_cast<const char *>(&value),
+                          sizeof(value)));
+  }
+
+  // Reads stream to the end and rewinds it
+  void HashStream(std::istream &str) {
+    if (!Enabled()) {
+      return;
+    }
+
+    std::string chunk(1 << 20, 0);
+    str.clear();
+    str.seekg(0);
+
+    while (str) {
+      str.read(chunk.data(), chunk.size());
+      Hash(std::string_view(chunk.data(), str.gcount()));
+    }
+
+    str.clear();
+    str.seekg(0);
+  }
+
+  // Optional input file, missing file is part of the key as well
+  void HashFile(const std::string &path) {
+    if (!Enabled()) {
+      return;
+    }
+
+    try {
+      AppContextStream stream = ctx->RequestFile(path);
+      Hash(true);
+      HashStream(*stream.Get());
+    } catch (const es::FileNotFoundError &) {
+      Hash(false);
+    }
+  }
+
+  // Writes stored outputs of cache entry, returns false on cache miss
+  bool Restore() {
+    if (!Enabled()) {
+      return false;
+    }
+
+    std::ifstream entry(EntryPath(), std::ios::binary);
+
+    if (!entry) {
+      return false;
+    }
+
+    std::stringstream contents;
+    contents << entry.rdbuf();
+    const std::string data = contents.str();
+    std::string_view rest(data);
+
+    auto ReadU64 = [&](uint64 &value) {
+      if (rest.size() < sizeof(value)) {
+        return false;
+      }
+
+      memcpy(&value, rest.data(), sizeof(value));
+      rest.remove_prefix(sizeof(value));
+      return true;
+    };
+
+    struct Item {
+      std::string_view extension;
+      std::string_view data;
+    };
+
+    std::vector<Item> items;
+    uint64 id;
+
+    // Truncated or foreign entry is treated as miss
+    if (!ReadU64(id) || id != ENTRY_ID) {
+      return false;
+    }
+
+    while (!rest.empty()) {
+      uint64 extensionSize;
+      uint64 dataSize;
+
+      if (!ReadU64(extensionSize) || !ReadU64(dataSize) ||
+          rest.size() < extensionSize + dataSize) {
+        return false;
+      }
+
+      items.push_back({rest.substr(0, extensionSize),
+                       rest.substr(extensionSize, dataSize)});
+      rest.remove_prefix(extensionSize + dataSize);
+    }
+
+    for (auto &i : items) {
+      auto &str = ctx->NewFile(ctx->workingFile.ChangeExtension(
+                                   std::string(i.extension)))
+                      .str;
+      str.write(i.data.data(), i.data.size());
+    }
+
+    return true;
+  }
+
+  // Output for working file with changed extension, buffered until Finish
+  // when cache is enabled
+  std::ostream &NewFile(std::string_view extension) {
+    if (!Enabled()) {
+      return ctx->NewFile(ctx->workingFile.ChangeExtension(
+                              std::string(extension)))
+          .str;
+    }
+
+    auto &out = outputs.emplace_back();
+    out.extension = extension;
+    return out.data;
+  }
+
+  // Writes buffered outputs and stores them as cache entry
+  void Finish() {
+    if (!Enabled()) {
+      return;
+    }
+
+    std::string entry;
+
+    auto AppendU64 = [&](uint64 value) {
+      entry.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    };
+
+    AppendU64(ENTRY_ID);
+
+    for (auto &o : outputs) {
+      const std::string data = o.data.str();
+      ctx->NewFile(ctx->workingFile.ChangeExtension(o.extension))
+          .str.write(data.data(), data.size());
+      AppendU64(o.extension.size());
+      AppendU64(data.size());
+      entry.append(o.extension);
+      entry.append(data);
+    }
+
+    outputs.clear();
+    Store(entry);
+  }
+
+private:
+  static constexpr uint64 ENTRY_ID = 0x3130454843414358; // XCACHE01
+
+  struct Output {
+    std::string extension;
+    std::stringstream data;
+  };
+
+  AppContext *ctx;
+  std::string folder;
+  std::string converterName;
+  uint64 key = 0;
+  std::list<Output> outputs;
+
+  // Entry is written into uniquely named file first, then renamed into place,
+  // so concurrent readers never see partial data.
+  // Outputs are already written, any failure is cache store miss.
+  void Store(std::string_view entry) {
+    namespace fs = std::filesystem;
+    const fs::path entryPath = EntryPath();
+    fs::path tmpPath;
+    std::error_code ec;
+    fs::create_directories(entryPath.parent_path(), ec);
+
+    // Exclusive creation, name is unique across threads and processes
+    FILE *tmpFile = nullptr;
+
+    for (size_t attempt = 0; !tmpFile && attempt < 8; attempt++) {
+      char suffix[0x40];
+      snprintf(suffix, sizeof(suffix), ".%016llx.tmp",
+               static_cast<unsigned long long>(UniqueId()));
+      tmpPath = entryPath;
+      tmpPath += suffix;
+      tmpFile = fopen(tmpPath.string().c_str(), "wbx");
+    }
+
+    if (!tmpFile) {
+      printwarning("Cannot create cache entry: " << tmpPath.string());
+      return;
+    }
+
+    const bool written =
+        fwrite(entry.data(), 1, entry.size(), tmpFile) == entry.size();
+
+    if (fclose(tmpFile) || !written) {
+      printwarning("Cannot write cache entry: " << tmpPath.string());
+      fs::remove(tmpPath, ec);
+      return;
+    }
+
+    fs::rename(tmpPath, entryPath, ec);
+
+    if (ec) {
+      printwarning("Cannot store cache entry: " << entryPath.string() << ", "
+                                                << ec.message());
+      fs::remove(tmpPath, ec);
+    }
+  }
+
+  // Random per process, mixed with thread and call counter
+  static uint64 UniqueId() {
+    static const uint64 processSeed = [] {
+      std::random_device rd;
+      return (uint64(rd()) << 32) | rd();
+    }();
+    static std::atomic<uint64> counter{0};
+    const uint64 threadId =
+        std::hash<std::thread::id>{}(std::this_thread::get_id());
+
+    return HashBytes(
+        std::string_view(reinterpret_cast<const char *>(&threadId),
+                         sizeof(threadId)),
+        processSeed + counter++);
+  }
+
+  std::filesystem::path EntryPath() const {
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", static_cast<unsigned long long>(key));
+    std::string name(converterName);
+    name.append("_").append(hex).append(".xcache");
+    return std::filesystem::path(folder) / name;
+  }
+};
@@ -0,0 +1,247 @@
+/*  xenoblade_toolset common code
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Streaming JSON writer, formatting matches nlohmann::json::dump(2), except
+// last digits of some floats (see Value).
+// Values are appended into buffer as they come, only nesting is tracked.
+// Buffer is flushed into stream (if any) once it grows over FLUSH_SIZE.
+class JSONWriter {
+public:
+  static constexpr size_t FLUSH_SIZE = 0x10000;
+
+  // depth: indentation level of root value, for nesting pre-rendered values
+  JSONWriter(std::ostream *stream_ = nullptr, size_t depth = 0)
+      : stream(stream_), baseDepth(depth) {}
+  ~JSONWriter() { Flush(); }
+
+  void BeginObject() { Begin('{'); }
+  void EndObject() { End('}'); }
+  void BeginArray() { Begin('['); }
+  void EndArray() { End(']'); }
+
+  void Key(std::string_view key) {
+    Separator();
+    String(key);
+    buffer.append(": ");
+    pendingKey = true;
+  }
+
+  void Value(std::string_view value) {
+    Separator();
+    String(value);
+  }
+
+  void Value(const char *value) {
+    if (value) {
+      Value(std::string_view(value));
+    } else {
+      Null();
+    }
+  }
+
+  void Value(bool value) {
+    Separator();
+    buffer.append(value ? "true" : "false");
+  }
+
+  template <std::integral C>
+    requires(!std::same_as<C, bool>)
+  void Value(C value) {
+    Separator();
+    char data[24];
+    auto res = std::to_chars(std::begin(data), std::end(data), value);
+    buffer.append(data, res.ptr);
+  }
+
+  template <std::floating_point C> void Value(C value) {
+    if (!std::isfinite(value)) {
+      Null();
+      return;
+    }
+
+    Separator();
+    // Same notation as nlohmann::json: fixed when decimal point position is
+    // within (-4, 15], scientific otherwise. Digits are shortest round trip,
+    // nlohmann (Grisu2) emits one more digit for about 1 % of values, both
+    // parse into same value.
+    char data[32];
+    auto res = std::to_chars(std::begin(data), std::end(data), double(value),
+                             std::chars_format::scientific);
+    const char *expBegin = std::find(std::begin(data), res.ptr, 'e') + 1;
+    int exponent = 0;
+    std::from_chars(expBegin + (*expBegin == '+'), res.ptr, exponent);
+    const int pointPos = exponent + 1;
+
+    if (pointPos > -4 && pointPos <= 15) {
+      res = std::to_chars(std::begin(data), std::end(data), double(value),
+                          std::chars_format::fixed);
+    }
+
+    std::string_view written(data, res.ptr);
+    buffer.append(written);
+
+    if (written.find_first_of(".e") == written.npos) {
+      buffer.append(".0");
+    }
+  }
+
+  void Null() {
+    Separator();
+    buffer.append("null");
+  }
+
+  // Inserts already formatted value
+  void Raw(std::string_view value) {
+    Separator();
+    buffer.append(value);
+    CheckFlush();
+  }
+
+  // Continues elements of container opened in another writer, for rendering
+  // its elements in parts. hasItems: container already has elements.
+  void Resume(bool hasItems) { scopes.push_back(hasItems); }
+
+  // Inserts elements rendered by resumed writer into open container
+  void RawElements(std::string_view elements) {
+    if (!elements.empty()) {
+      buffer.append(elements);
+      scopes.back() = true;
+    }
+
+    CheckFlush();
+  }
+
+  template <class C> void Field(std::string_view key, C &&value) {
+    Key(key);
+    Value(std::forward<C>(value));
+  }
+
+  std::string &Buffer() { return buffer; }
+
+  void Flush() {
+    if (stream) {
+      stream->write(buffer.data(), buffer.size());
+      buffer.clear();
+    }
+  }
+
+private:
+  std::ostream *stream;
+  size_t baseDepth;
+  std::string buffer;
+  // true when container has at least one element
+  std::vector<bool> scopes;
+  bool pendingKey = false;
+
+  void Indent(size_t depth) {
+    buffer.push_back('\n');
+    buffer.append((baseDepth + depth) * 2, ' ');
+  }
+
+  void Separator() {
+    if (pendingKey) {
+      pendingKey = false;
+      return;
+    }
+
+    if (scopes.empty()) {
+      return;
+    }
+
+    if (scopes.back()) {
+      buffer.push_back(',');
+    }
+
+    scopes.back() = true;
+    Indent(scopes.size());
+  }
+
+  void Begin(char token) {
+    Separator();
+    buffer.push_back(token);
+    scopes.push_back(false);
+  }
+
+  void End(char token) {
+    const bool hasItems = scopes.back();
+    scopes.pop_back();
+
+    if (hasItems) {
+      Indent(scopes.size());
+    }
+
+    buffer.push_back(token);
+    CheckFlush();
+  }
+
+  void CheckFlush() {
+    if (buffer.size() > FLUSH_SIZE) {
+      Flush();
+    }
+  }
+
+  void String(std::string_view str) {
+    static const char HEX[] = "0123456789abcdef";
+    buffer.push_back('"');
+
+    for (char c : str) {
+      switch (c) {
+      case '"':
+        buffer.append("\\\"");
+        break;
+      case '\\':
+        buffer.append("\\\\");
+        break;
+      case '\b':
+        buffer.append("\\b");
+        break;
+      case '\f':
+        buffer.append("\\f");
+        break;
+      case '\n':
+        buffer.append("\\n");
+        break;
+      case '\r':
+        buffer.append("\\r");
+        break;
+      case '\t':
+        buffer.append("\\t");
+        break;
+      default:
+        if (uint8_t(c) < 0x20) {
+          buffer.append("\\u00");
+          buffer.push_back(HEX[c >> 4]);
+          buffer.push_back(HEX[c & 0xf]);
+        } else {
+          buffer.push_back(c);
+        }
+      }
+    }
+
+    buffer.push_back('"');
+  }
+};
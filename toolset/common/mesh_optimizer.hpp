@@ -0,0 +1,389 @@
+/*  xenoblade_toolset common code
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "spike/util/supercore.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+/*
+Triangle list optimizations, applied in order:
+
+  MeshOptimizer::OptimizeVertexCache(indices, numVertices);
+  MeshOptimizer::OptimizeOverdraw(indices, positions, 16, numVertices);
+  MeshOptimizer::VertexRemap remap(numVertices);
+  remap.AddIndices(indices); // for every index buffer of vertex buffer
+  remap.Finish();
+  remap.Apply(attribute);
+
+Only triangle order (and vertex numbering for remap) is changed,
+every triangle keeps its vertices and winding.
+*/
+
+namespace MeshOptimizer {
+inline constexpr uint32 CACHE_SIZE = 16;
+
+// Tipsify (Sander, Nehab, Barczak 2007), reorders triangles for
+// post transform vertex cache of cacheSize.
+inline void OptimizeVertexCache(std::span<uint32> indices,
+                                size_t numVertices,
+                                uint32 cacheSize = CACHE_SIZE) {
+  const size_t numFaces = indices.size() / 3;
+
+  if (numFaces < 2) {
+    return;
+  }
+
+  // Faces using vertex v are within [offsets[v], offsets[v + 1])
+  std::vector<uint32> offsets(numVertices + 1, 0);
+
+  for (uint32 v : indices) {
+    if (v >= numVertices) {
+      throw std::out_of_range("Vertex index is out of range");
+    }
+
+    offsets[v + 1]++;
+  }
+
+  for (size_t v = 0; v < numVertices; v++) {
+    offsets[v + 1] += offsets[v];
+  }
+
+  std::vector<uint32> adjacency(numFaces * 3);
+  std::vector<uint32> liveFaces(numVertices);
+  {
+    std::vector<uint32> cursor(offsets.begin(), offsets.end() - 1);
+
+    for (size_t i = 0; i < numFaces * 3; i++) {
+      adjacency[cursor[indices[i]]++] = i / 3;
+    }
+
+    for (size_t v = 0; v < numVertices; v++) {
+      liveFaces[v] = offsets[v + 1] - offsets[v];
+    }
+  }
+
+  std::vector<uint32> timestamps(numVertices, 0);
+  std::vector<bool> emitted(numFaces, false);
+  std::vector<uint32> deadEnd;
+  std::vector<uint32> candidates;
+  std::vector<uint32> result;
+  result.reserve(numFaces * 3);
+  uint32 time = cacheSize + 1;
+  size_t nextVertex = 0;
+
+  auto SkipDeadEnd = [&]() -> int64 {
+    while (!deadEnd.empty()) {
+      const uint32 v = deadEnd.back();
+      deadEnd.pop_back();
+
+      if (liveFaces[v]) {
+        return v;
+      }
+    }
+
+    for (; nextVertex < numVertices; nextVertex++) {
+      if (liveFaces[nextVertex]) {
+        return nextVertex;
+      }
+    }
+
+    return -1;
+  };
+
+  for (int64 fanning = SkipDeadEnd(); fanning >= 0;) {
+    candidates.clear();
+
+    for (uint32 a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+      const uint32 face = adjacency[a];
+
+      if (emitted[face]) {
+        continue;
+      }
+
+      emitted[face] = true;
+
+      for (size_t c = 0; c < 3; c++) {
+        const uint32 v = indices[face * 3 + c];
+        result.push_back(v);
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        liveFaces[v]--;
+
+        if (time - timestamps[v] > cacheSize) {
+          timestamps[v] = time++;
+        }
+      }
+    }
+
+    // Prefer vertex that stays in cache while its remaining faces are
+    // emitted, oldest first
+    int64 bestPriority = -1;
+    fanning = -1;
+
+    for (uint32 v : candidates) {
+      if (!liveFaces[v]) {
+        continue;
+      }
+
+      int64 priority = 0;
+
+      if (time - timestamps[v] + 2 * liveFaces[v] <= cacheSize) {
+        priority = time - timestamps[v];
+      }
+
+      if (priority > bestPriority) {
+        bestPriority = priority;
+        fanning = v;
+      }
+    }
+
+    if (fanning < 0) {
+      fanning = SkipDeadEnd();
+    }
+  }
+
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+// Reorders clusters of cache optimized triangles, so outward facing
+// clusters are drawn first. Cluster is split when its cache miss ratio
+// is within threshold of its hard cluster (split by cache flush).
+// positionStride is in bytes, positions are 3 floats.
+inline void OptimizeOverdraw(std::span<uint32> indices,
+                             const float *positions, size_t positionStride,
+                             size_t numVertices, float threshold = 1.05f,
+                             uint32 cacheSize = CACHE_SIZE) {
+  const size_t numFaces = indices.size() / 3;
+
+  if (numFaces < 2) {
+    return;
+  }
+
+  std::vector<uint32> timestamps(numVertices, 0);
+  uint32 time = cacheSize + 1;
+
+  auto CacheMisses = [&](size_t face) {
+    uint32 misses = 0;
+
+    for (size_t c = 0; c < 3; c++) {
+      const uint32 v = indices[face * 3 + c];
+
+      if (v >= numVertices) {
+        throw std::out_of_range("Vertex index is out of range");
+      }
+
+      if (time - timestamps[v] > cacheSize) {
+        timestamps[v] = time++;
+        misses++;
+      }
+    }
+
+    return misses;
+  };
+
+  auto FlushCache = [&] { time += cacheSize + 1; };
+
+  std::vector<uint32> hardBoundaries;
+  std::vector<uint32> faceMisses(numFaces);
+
+  for (size_t f = 0; f < numFaces; f++) {
+    faceMisses[f] = CacheMisses(f);
+
+    if (f == 0 || faceMisses[f] == 3) {
+      hardBoundaries.push_back(f);
+    }
+  }
+
+  hardBoundaries.push_back(numFaces);
+  std::vector<uint32> clusters;
+
+  for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+    const uint32 begin = hardBoundaries[h];
+    const uint32 end = hardBoundaries[h + 1];
+    uint32 totalMisses = 0;
+
+    for (uint32 f = begin; f < end; f++) {
+      totalMisses += faceMisses[f];
+    }
+
+    const float clusterRatio = float(totalMisses) / (end - begin);
+    uint32 misses = 0;
+    uint32 numClusterFaces = 0;
+    clusters.push_back(begin);
+    FlushCache();
+
+    for (uint32 f = begin; f < end; f++) {
+      misses += CacheMisses(f);
+      numClusterFaces++;
+
+      if (f + 1 < end &&
+          float(misses) / numClusterFaces <= clusterRatio * threshold) {
+        clusters.push_back(f + 1);
+        misses = 0;
+        numClusterFaces = 0;
+        FlushCache();
+      }
+    }
+  }
+
+  clusters.push_back(numFaces);
+
+  auto Position = [&](uint32 v) {
+    const char *data =
+        reinterpret_cast<const char *>(positions) + v * positionStride;
+    float retVal[3];
+    memcpy(retVal, data, sizeof(retVal));
+    return std::to_array(retVal);
+  };
+
+  double meshCenter[3]{};
+
+  for (uint32 v : indices.first(numFaces * 3)) {
+    auto pos = Position(v);
+
+    for (size_t c = 0; c < 3; c++) {
+      meshCenter[c] += pos[c];
+    }
+  }
+
+  for (auto &c : meshCenter) {
+    c /= numFaces * 3;
+  }
+
+  struct Cluster {
+    uint32 begin;
+    uint32 end;
+    float sortKey;
+  };
+
+  std::vector<Cluster> sorted;
+
+  for (size_t c = 0; c + 1 < clusters.size(); c++) {
+    Cluster cluster{clusters[c], clusters[c + 1], 0};
+    double center[3]{};
+    double normal[3]{};
+
+    for (uint32 f = cluster.begin; f < cluster.end; f++) {
+      auto p0 = Position(indices[f * 3]);
+      auto p1 = Position(indices[f * 3 + 1]);
+      auto p2 = Position(indices[f * 3 + 2]);
+      const double e0[3]{p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      const double e1[3]{p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+
+      // Area weighted
+      normal[0] += e0[1] * e1[2] - e0[2] * e1[1];
+      normal[1] += e0[2] * e1[0] - e0[0] * e1[2];
+      normal[2] += e0[0] * e1[1] - e0[1] * e1[0];
+
+      for (size_t i = 0; i < 3; i++) {
+        center[i] += p0[i] + p1[i] + p2[i];
+      }
+    }
+
+    const double numVerts = (cluster.end - cluster.begin) * 3;
+    const double normalLength = std::sqrt(
+        normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+    if (normalLength > 0) {
+      double key = 0;
+
+      for (size_t i = 0; i < 3; i++) {
+        key += (center[i] / numVerts - meshCenter[i]) * normal[i];
+      }
+
+      cluster.sortKey = key / normalLength;
+    }
+
+    sorted.push_back(cluster);
+  }
+
+  std::stable_sort(sorted.begin(), sorted.end(), [](auto &a, auto &b) {
+    return a.sortKey > b.sortKey;
+  });
+
+  std::vector<uint32> result;
+  result.reserve(numFaces * 3);
+
+  for (auto &c : sorted) {
+    result.insert(result.end(), indices.begin() + c.begin * 3,
+                  indices.begin() + c.end * 3);
+  }
+
+  std::copy(result.begin(), result.end(), indices.begin());
+}
+
+// Renumbers vertices in order of first use (vertex fetch locality).
+// Unreferenced vertices are kept after used ones, in original order.
+class VertexRemap {
+public:
+  static constexpr uint32 UNUSED = -1U;
+
+  VertexRemap(size_t numVertices) : oldToNew(numVertices, UNUSED) {}
+
+  // Indices are renumbered in place
+  void AddIndices(std::span<uint32> indices) {
+    for (uint32 &i : indices) {
+      uint32 &newIndex = oldToNew.at(i);
+
+      if (newIndex == UNUSED) {
+        newIndex = newToOld.size();
+        newToOld.push_back(i);
+      }
+
+      i = newIndex;
+    }
+  }
+
+  void Finish() {
+    for (uint32 v = 0; v < oldToNew.size(); v++) {
+      if (oldToNew[v] == UNUSED) {
+        oldToNew[v] = newToOld.size();
+        newToOld.push_back(v);
+      }
+    }
+  }
+
+  uint32 NewIndex(uint32 oldIndex) const { return oldToNew.at(oldIndex); }
+  uint32 OldIndex(uint32 newIndex) const { return newToOld.at(newIndex); }
+
+  // Reorders per vertex items, elementSize items per vertex
+  template <class C> void Apply(C &items, size_t elementSize = 1) const {
+    if (items.size() != newToOld.size() * elementSize) {
+      throw std::runtime_error("Vertex attribute size mismatch");
+    }
+
+    C reordered(items);
+
+    for (size_t v = 0; v < newToOld.size(); v++) {
+      std::copy_n(items.begin() + newToOld[v] * elementSize, elementSize,
+                  reordered.begin() + v * elementSize);
+    }
+
+    std::swap(items, reordered);
+  }
+
+private:
+  std::vector<uint32> oldToNew;
+  std::vector<uint32> newToOld;
+};
+} // namespace MeshOptimizer
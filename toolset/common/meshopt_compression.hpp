@@ -0,0 +1,708 @@
+/*  xenoblade_toolset common code
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "nlohmann/json.hpp"
+#include "spike/util/supercore.hpp"
+#include "worker_pool.hpp"
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/*
+EXT_meshopt_compression codecs (vertex codec version 0, index codec
+version 1, no filters) and GLB post process.
+
+  std::stringstream glb;
+  main.FinishAndSave(glb, {});
+  output << Meshopt::CompressGLB(glb.str());
+
+Encoders are checked against reference vectors and decoders in
+toolset/test/meshopt_compression_test.cpp.
+*/
+
+namespace Meshopt {
+namespace detail {
+inline constexpr uint8 VERTEX_HEADER = 0xa0;
+inline constexpr uint8 INDEX_HEADER = 0xe1;
+inline constexpr size_t BYTE_GROUP_SIZE = 16;
+inline constexpr size_t VERTEX_BLOCK_MAX_SIZE = 256;
+inline constexpr size_t VERTEX_BLOCK_SIZE_BYTES = 8192;
+inline constexpr size_t TAIL_MAX_SIZE = 32;
+
+inline size_t VertexBlockSize(size_t vertexSize) {
+  const size_t result =
+      (VERTEX_BLOCK_SIZE_BYTES / vertexSize) & ~(BYTE_GROUP_SIZE - 1);
+  return std::min(result, VERTEX_BLOCK_MAX_SIZE);
+}
+
+// Encoded size of 16 byte group, bits of 1 stands for all zero group
+inline size_t GroupSize(const uint8 *group, uint32 bits) {
+  if (bits == 1) {
+    return std::all_of(group, group + BYTE_GROUP_SIZE,
+                       [](uint8 b) { return b == 0; })
+               ? 0
+               : size_t(-1);
+  }
+
+  if (bits == 8) {
+    return BYTE_GROUP_SIZE;
+  }
+
+  const uint8 sentinel = (1 << bits) - 1;
+  size_t result = BYTE_GROUP_SIZE * bits / 8;
+
+  for (size_t i = 0; i < BYTE_GROUP_SIZE; i++) {
+    result += group[i] >= sentinel;
+  }
+
+  return result;
+}
+
+// Fixed part of bits per value, then full byte for each value
+// that does not fit (stored as sentinel in fixed part)
+inline void EncodeGroup(std::string &out, const uint8 *group, uint32 bits) {
+  if (bits == 1) {
+    return;
+  }
+
+  if (bits == 8) {
+    out.append(reinterpret_cast<const char *>(group), BYTE_GROUP_SIZE);
+    return;
+  }
+
+  const uint8 sentinel = (1 << bits) - 1;
+  const size_t valuesPerByte = 8 / bits;
+
+  for (size_t i = 0; i < BYTE_GROUP_SIZE; i += valuesPerByte) {
+    uint8 packed = 0;
+
+    for (size_t k = 0; k < valuesPerByte; k++) {
+      packed <<= bits;
+      packed |= std::min(group[i + k], sentinel);
+    }
+
+    out.push_back(packed);
+  }
+
+  for (size_t i = 0; i < BYTE_GROUP_SIZE; i++) {
+    if (group[i] >= sentinel) {
+      out.push_back(group[i]);
+    }
+  }
+}
+
+// Header of 2 bits per group (zero, 2 bits, 4 bits, raw), then groups
+inline void EncodeBytes(std::string &out, const uint8 *buffer, size_t size) {
+  const size_t headerBegin = out.size();
+  out.append((size / BYTE_GROUP_SIZE + 3) / 4, 0);
+
+  for (size_t i = 0; i < size; i += BYTE_GROUP_SIZE) {
+    uint32 bestBits = 8;
+    size_t bestSize = GroupSize(buffer + i, 8);
+
+    for (uint32 bits = 1; bits < 8; bits *= 2) {
+      if (size_t groupSize = GroupSize(buffer + i, bits);
+          groupSize < bestSize) {
+        bestBits = bits;
+        bestSize = groupSize;
+      }
+    }
+
+    const uint32 bitsLog2 = bestBits == 1 ? 0 : bestBits == 2 ? 1
+                                            : bestBits == 4   ? 2
+                                                              : 3;
+    const size_t group = i / BYTE_GROUP_SIZE;
+    out[headerBegin + group / 4] |= bitsLog2 << ((group % 4) * 2);
+    EncodeGroup(out, buffer + i, bestBits);
+  }
+}
+
+inline void EncodeVByte(std::string &out, uint32 value) {
+  do {
+    out.push_back((value & 127) | (value > 127 ? 128 : 0));
+    value >>= 7;
+  } while (value);
+}
+
+inline constexpr uint8 CODE_AUX_TABLE[16]{
+    0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86,
+    0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00,
+};
+
+inline constexpr uint32 TRIANGLE_ORDER[3][3]{{0, 1, 2}, {1, 2, 0}, {2, 0, 1}};
+
+// Edge and vertex fifos shared by index encoder and decoder
+struct IndexState {
+  uint32 edges[16][2];
+  uint32 vertices[16];
+  size_t edgeOffset = 0;
+  size_t vertexOffset = 0;
+  uint32 next = 0;
+  uint32 last = 0;
+
+  IndexState() {
+    memset(edges, -1, sizeof(edges));
+    memset(vertices, -1, sizeof(vertices));
+  }
+
+  void PushEdge(uint32 a, uint32 b) {
+    edges[edgeOffset][0] = a;
+    edges[edgeOffset][1] = b;
+    edgeOffset = (edgeOffset + 1) & 15;
+  }
+
+  void PushVertex(uint32 v, bool cond = true) {
+    vertices[vertexOffset] = v;
+    vertexOffset = (vertexOffset + cond) & 15;
+  }
+
+  // Returns (fifo index << 2) | rotation or -1
+  int32 FindEdge(uint32 a, uint32 b, uint32 c) const {
+    for (int32 i = 0; i < 16; i++) {
+      auto &e = edges[(edgeOffset - 1 - i) & 15];
+
+      if (e[0] == a && e[1] == b) {
+        return i << 2;
+      } else if (e[0] == b && e[1] == c) {
+        return (i << 2) | 1;
+      } else if (e[0] == c && e[1] == a) {
+        return (i << 2) | 2;
+      }
+    }
+
+    return -1;
+  }
+
+  int32 FindVertex(uint32 v) const {
+    for (int32 i = 0; i < 16; i++) {
+      if (vertices[(vertexOffset - 1 - i) & 15] == v) {
+        return i;
+      }
+    }
+
+    return -1;
+  }
+
+  void EncodeIndex(std::string &out, uint32 index) {
+    const uint32 delta = index - last;
+    EncodeVByte(out, (delta << 1) ^ uint32(int32(delta) >> 31));
+    last = index;
+  }
+};
+} // namespace detail
+
+// ATTRIBUTES mode, vertexSize must be multiple of 4 up to 256
+inline std::string EncodeVertexBuffer(const char *vertices, size_t numVertices,
+                                      size_t vertexSize) {
+  using namespace detail;
+
+  if (vertexSize == 0 || vertexSize > 256 || vertexSize % 4) {
+    throw std::invalid_argument("Invalid meshopt vertex size");
+  }
+
+  std::string out(1, char(VERTEX_HEADER));
+  auto data = reinterpret_cast<const uint8 *>(vertices);
+  uint8 firstVertex[256]{};
+
+  if (numVertices) {
+    memcpy(firstVertex, data, vertexSize);
+  }
+
+  uint8 lastVertex[256];
+  memcpy(lastVertex, firstVertex, vertexSize);
+  const size_t blockSize = VertexBlockSize(vertexSize);
+  uint8 buffer[VERTEX_BLOCK_MAX_SIZE]{};
+
+  for (size_t offset = 0; offset < numVertices; offset += blockSize) {
+    const size_t numBlockVerts = std::min(blockSize, numVertices - offset);
+    const size_t alignedVerts =
+        (numBlockVerts + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+    const uint8 *block = data + offset * vertexSize;
+
+    for (size_t k = 0; k < vertexSize; k++) {
+      uint8 prev = lastVertex[k];
+
+      for (size_t i = 0; i < numBlockVerts; i++) {
+        const uint8 value = block[i * vertexSize + k];
+        const uint8 delta = value - prev;
+        // zigzag
+        buffer[i] = (delta << 1) ^ uint8(int8(delta) >> 7);
+        prev = value;
+      }
+
+      EncodeBytes(out, buffer, alignedVerts);
+    }
+
+    memcpy(lastVertex, block + (numBlockVerts - 1) * vertexSize, vertexSize);
+  }
+
+  // First vertex is stored at the end, padded to TAIL_MAX_SIZE
+  if (vertexSize < TAIL_MAX_SIZE) {
+    out.append(TAIL_MAX_SIZE - vertexSize, 0);
+  }
+
+  out.append(reinterpret_cast<const char *>(firstVertex), vertexSize);
+
+  return out;
+}
+
+// TRIANGLES mode, triangle list
+inline std::string EncodeIndexBuffer(std::span<const uint32> indices) {
+  using namespace detail;
+
+  if (indices.size() % 3) {
+    throw std::invalid_argument("Index count is not multiple of 3");
+  }
+
+  const size_t numFaces = indices.size() / 3;
+  std::string codes(1, char(INDEX_HEADER));
+  std::string data;
+  codes.reserve(1 + numFaces);
+  IndexState st;
+  const int32 fecMax = 13;
+
+  for (size_t i = 0; i < indices.size(); i += 3) {
+    const int32 fer = st.FindEdge(indices[i], indices[i + 1], indices[i + 2]);
+
+    if (fer >= 0 && (fer >> 2) < 15) {
+      const uint32 *order = TRIANGLE_ORDER[fer & 3];
+      const uint32 a = indices[i + order[0]];
+      const uint32 b = indices[i + order[1]];
+      const uint32 c = indices[i + order[2]];
+      const int32 fe = fer >> 2;
+      const int32 fc = st.FindVertex(c);
+      int32 fec = 15;
+
+      if (fc >= 1 && fc < fecMax) {
+        fec = fc;
+      } else if (c == st.next) {
+        st.next++;
+        fec = 0;
+      } else if (c + 1 == st.last) {
+        fec = 13;
+        st.last = c;
+      } else if (c == st.last + 1) {
+        fec = 14;
+        st.last = c;
+      }
+
+      codes.push_back((fe << 4) | fec);
+
+      if (fec == 15) {
+        st.EncodeIndex(data, c);
+      }
+
+      if (fec == 0 || fec >= fecMax) {
+        st.PushVertex(c);
+      }
+
+      st.PushEdge(c, b);
+      st.PushEdge(a, c);
+    } else {
+      const uint32 next = st.next;
+      const uint32 rotation = indices[i + 1] == next   ? 1
+                              : indices[i + 2] == next ? 2
+                                                       : 0;
+      const uint32 *order = TRIANGLE_ORDER[rotation];
+      const uint32 a = indices[i + order[0]];
+      const uint32 b = indices[i + order[1]];
+      const uint32 c = indices[i + order[2]];
+      bool reset = false;
+
+      if (a == 0 && b == 1 && c == 2 && st.next > 0) {
+        reset = true;
+        st.next = 0;
+        memset(st.vertices, -1, sizeof(st.vertices));
+      }
+
+      const int32 fb = st.FindVertex(b);
+      const int32 fc = st.FindVertex(c);
+
+      auto FifoCode = [&](int32 found, uint32 v) {
+        if (found >= 0 && found < 14) {
+          return found + 1;
+        } else if (v == st.next) {
+          st.next++;
+          return 0;
+        }
+
+        return 15;
+      };
+
+      int32 fea = 15;
+
+      if (a == st.next) {
+        st.next++;
+        fea = 0;
+      }
+
+      const int32 feb = FifoCode(fb, b);
+      const int32 fec = FifoCode(fc, c);
+      const uint8 codeAux = (feb << 4) | fec;
+      auto tableEnd = std::begin(CODE_AUX_TABLE) + 14;
+      auto found = std::find(std::begin(CODE_AUX_TABLE), tableEnd, codeAux);
+
+      if (fea == 0 && found != tableEnd && !reset) {
+        codes.push_back(0xf0 | (found - std::begin(CODE_AUX_TABLE)));
+      } else {
+        codes.push_back(0xf0 | 14 | fea);
+        data.push_back(codeAux);
+      }
+
+      if (fea == 15) {
+        st.EncodeIndex(data, a);
+      }
+
+      if (feb == 15) {
+        st.EncodeIndex(data, b);
+      }
+
+      if (fec == 15) {
+        st.EncodeIndex(data, c);
+      }
+
+      if (fea == 0 || fea == 15) {
+        st.PushVertex(a);
+      }
+
+      if (feb == 0 || feb == 15) {
+        st.PushVertex(b);
+      }
+
+      if (fec == 0 || fec == 15) {
+        st.PushVertex(c);
+      }
+
+      st.PushEdge(b, a);
+      st.PushEdge(c, b);
+      st.PushEdge(a, c);
+    }
+  }
+
+  // Table is used by decoder and also as padding
+  codes.append(data);
+  codes.append(reinterpret_cast<const char *>(CODE_AUX_TABLE), 16);
+
+  return codes;
+}
+
+// Moves vertex (byteStride views) and triangle index data of embedded buffer
+// into EXT_meshopt_compression streams. Original layout is kept in fallback
+// buffer without data, so extension is required.
+// Other buffers and views are kept as is.
+inline std::string CompressGLB(std::string_view glb) {
+  using json = nlohmann::json;
+  static constexpr uint32 GLB_MAGIC = 0x46546C67;
+  static constexpr uint32 JSON_CHUNK = 0x4E4F534A;
+  static constexpr uint32 BIN_CHUNK = 0x004E4942;
+  static constexpr uint32 TRIANGLES = 4;
+  static constexpr uint32 ELEMENT_ARRAY_BUFFER = 34963;
+  static constexpr const char *EXTENSION = "EXT_meshopt_compression";
+
+  auto ReadU32 = [&](size_t offset) {
+    if (offset + 4 > glb.size()) {
+      throw std::runtime_error("GLB is truncated");
+    }
+
+    uint32 value;
+    memcpy(&value, glb.data() + offset, 4);
+    return value;
+  };
+
+  if (ReadU32(0) != GLB_MAGIC || ReadU32(4) != 2) {
+    throw std::runtime_error("Invalid GLB header");
+  }
+
+  const uint32 jsonSize = ReadU32(12);
+
+  if (ReadU32(16) != JSON_CHUNK || 20 + jsonSize > glb.size()) {
+    throw std::runtime_error("Invalid GLB json chunk");
+  }
+
+  json doc = json::parse(glb.substr(20, jsonSize));
+  std::string_view bin;
+
+  if (const size_t binBegin = 20 + jsonSize; binBegin < glb.size()) {
+    const uint32 binSize = ReadU32(binBegin);
+
+    if (ReadU32(binBegin + 4) != BIN_CHUNK ||
+        binBegin + 8 + binSize > glb.size()) {
+      throw std::runtime_error("Invalid GLB bin chunk");
+    }
+
+    bin = glb.substr(binBegin + 8, binSize);
+  }
+
+  if (bin.empty() || !doc.contains("buffers") || doc["buffers"].empty() ||
+      doc["buffers"][0].contains("uri") || !doc.contains("bufferViews") ||
+      !doc.contains("accessors")) {
+    return std::string(glb);
+  }
+
+  json &views = doc["bufferViews"];
+  json &accessors = doc["accessors"];
+  const size_t fallbackBuffer = doc["buffers"].size();
+
+  // Index accessors, that are used only by triangle lists
+  std::vector<int8> triangleIndices(accessors.size(), -1);
+
+  for (auto &mesh : doc.value("meshes", json::array())) {
+    for (auto &prim : mesh["primitives"]) {
+      if (!prim.contains("indices")) {
+        continue;
+      }
+
+      int8 &state = triangleIndices.at(prim["indices"].get<size_t>());
+      const bool isTriangles = prim.value("mode", TRIANGLES) == TRIANGLES;
+      state = state != 0 && isTriangles;
+    }
+  }
+
+  struct Job {
+    size_t offset;
+    size_t count;
+    size_t stride;
+    bool isIndex;
+    std::string encoded;
+  };
+
+  // New views are appended after original ones, index accessors get
+  // their own view, so every stream has single component type
+  std::vector<Job> jobs(views.size());
+  std::vector<bool> compressed(views.size(), false);
+  // Views, whose accessors were all moved into their own views
+  std::vector<bool> emptied(views.size(), false);
+  std::vector<size_t> numUses(views.size(), 0);
+
+  auto CountView = [&](const json &item) {
+    if (item.contains("bufferView")) {
+      numUses.at(item["bufferView"].get<size_t>())++;
+    }
+  };
+
+  for (auto &a : accessors) {
+    CountView(a);
+
+    if (a.contains("sparse")) {
+      CountView(a["sparse"]["indices"]);
+      CountView(a["sparse"]["values"]);
+    }
+  }
+
+  for (auto &image : doc.value("images", json::array())) {
+    CountView(image);
+  }
+
+  for (size_t v = 0; v < views.size(); v++) {
+    json &view = views[v];
+    const size_t stride = view.value("byteStride", 0);
+    const size_t length = view["byteLength"];
+
+    if (view.value("buffer", 0) == 0 && stride && stride % 4 == 0 &&
+        stride <= 256 && length % stride == 0) {
+      jobs[v] = {view.value("byteOffset", size_t(0)), length / stride, stride,
+                 false, {}};
+      compressed[v] = true;
+    }
+  }
+
+  for (size_t a = 0; a < accessors.size(); a++) {
+    json &acc = accessors[a];
+
+    if (triangleIndices[a] != 1 || acc.contains("sparse")) {
+      continue;
+    }
+
+    const size_t v = acc["bufferView"];
+    json &view = views[v];
+    const size_t count = acc["count"];
+    const uint32 type = acc["componentType"];
+    const size_t stride = type == 5123 ? 2 : type == 5125 ? 4 : 0;
+
+    if (view.value("buffer", 0) != 0 || compressed[v] || !stride ||
+        count % 3) {
+      continue;
+    }
+
+    const size_t offset = view.value("byteOffset", size_t(0)) +
+                          acc.value("byteOffset", size_t(0));
+    views.push_back({
+        {"buffer", 0},
+        {"byteOffset", offset},
+        {"byteLength", count * stride},
+        {"target", ELEMENT_ARRAY_BUFFER},
+    });
+    jobs.push_back({offset, count, stride, true, {}});
+    compressed.push_back(true);
+    numUses.push_back(1);
+    emptied.push_back(false);
+    emptied[v] = --numUses[v] == 0;
+    acc["bufferView"] = views.size() - 1;
+    acc.erase("byteOffset");
+  }
+
+  ParallelFor(jobs.size(), [&](size_t j) {
+    Job &job = jobs[j];
+
+    if (!compressed[j]) {
+      return;
+    }
+
+    if (job.offset + job.count * job.stride > bin.size()) {
+      throw std::runtime_error("Buffer view is out of GLB bin chunk");
+    }
+
+    const char *data = bin.data() + job.offset;
+
+    if (!job.isIndex) {
+      job.encoded = EncodeVertexBuffer(data, job.count, job.stride);
+      return;
+    }
+
+    std::vector<uint32> indices(job.count);
+
+    for (size_t i = 0; i < job.count; i++) {
+      if (job.stride == 2) {
+        uint16 index;
+        memcpy(&index, data + i * 2, 2);
+        indices[i] = index;
+      } else {
+        memcpy(&indices[i], data + i * 4, 4);
+      }
+    }
+
+    job.encoded = EncodeIndexBuffer(indices);
+  });
+
+  std::vector<int64> viewRemap(views.size(), -1);
+  json newViews = json::array();
+  std::string newBin;
+  size_t fallbackSize = 0;
+
+  auto Append = [&](std::string_view data) {
+    newBin.append((4 - newBin.size() % 4) % 4, 0);
+    const size_t offset = newBin.size();
+    newBin.append(data);
+    return offset;
+  };
+
+  for (size_t v = 0; v < views.size(); v++) {
+    if (emptied[v]) {
+      continue;
+    }
+
+    json &view = views[v];
+
+    viewRemap[v] = newViews.size();
+
+    if (view.value("buffer", 0) != 0) {
+      newViews.emplace_back(std::move(view));
+      continue;
+    }
+
+    const size_t length = view["byteLength"];
+
+    if (!compressed[v]) {
+      const size_t offset = view.value("byteOffset", size_t(0));
+      view["byteOffset"] = Append(bin.substr(offset, length));
+      newViews.emplace_back(std::move(view));
+      continue;
+    }
+
+    Job &job = jobs[v];
+    json ext{
+        {"buffer", 0},
+        {"byteOffset", Append(job.encoded)},
+        {"byteLength", job.encoded.size()},
+        {"byteStride", job.stride},
+        {"count", job.count},
+        {"mode", job.isIndex ? "TRIANGLES" : "ATTRIBUTES"},
+    };
+
+    fallbackSize = (fallbackSize + 3) & ~size_t(3);
+    view["buffer"] = fallbackBuffer;
+    view["byteOffset"] = fallbackSize;
+    view["extensions"][EXTENSION] = std::move(ext);
+    fallbackSize += length;
+    newViews.emplace_back(std::move(view));
+  }
+
+  auto RemapView = [&](json &item) {
+    if (item.contains("bufferView")) {
+      item["bufferView"] = viewRemap.at(item["bufferView"].get<size_t>());
+    }
+  };
+
+  for (auto &acc : accessors) {
+    RemapView(acc);
+
+    if (acc.contains("sparse")) {
+      RemapView(acc["sparse"]["indices"]);
+      RemapView(acc["sparse"]["values"]);
+    }
+  }
+
+  if (doc.contains("images")) {
+    for (auto &image : doc["images"]) {
+      RemapView(image);
+    }
+  }
+
+  newBin.append((4 - newBin.size() % 4) % 4, 0);
+  views = std::move(newViews);
+  doc["buffers"][0]["byteLength"] = newBin.size();
+  doc["buffers"].push_back({
+      {"byteLength", fallbackSize},
+      {"extensions", {{EXTENSION, {{"fallback", true}}}}},
+  });
+
+  for (const char *list : {"extensionsUsed", "extensionsRequired"}) {
+    json &extensions = doc[list];
+
+    if (std::find(extensions.begin(), extensions.end(), EXTENSION) ==
+        extensions.end()) {
+      extensions.push_back(EXTENSION);
+    }
+  }
+
+  std::string newJson = doc.dump();
+  newJson.append((4 - newJson.size() % 4) % 4, ' ');
+  std::string retVal;
+  retVal.reserve(28 + newJson.size() + newBin.size());
+
+  auto WriteU32 = [&](uint32 value) {
+    retVal.append(reinterpret_cast<const char *>(&value), 4);
+  };
+
+  WriteU32(GLB_MAGIC);
+  WriteU32(2);
+  WriteU32(28 + newJson.size() + newBin.size());
+  WriteU32(newJson.size());
+  WriteU32(JSON_CHUNK);
+  retVal.append(newJson);
+  WriteU32(newBin.size());
+  WriteU32(BIN_CHUNK);
+  retVal.append(newBin);
+
+  return retVal;
+}
+} // namespace Meshopt
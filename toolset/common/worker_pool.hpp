@@ -0,0 +1,276 @@
+/*  xenoblade_toolset common code
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+// Process wide pool, threads are created on first use and shared by all
+// parallel calls, including calls from several AppProcessFile threads.
+class WorkerPool {
+public:
+  static WorkerPool &Get() {
+    // Never destroyed, joining threads while module unloads can deadlock
+    static WorkerPool *pool = new WorkerPool;
+    return *pool;
+  }
+
+  size_t NumThreads() const { return numThreads; }
+
+  void Submit(std::function<void()> task) {
+    {
+      std::lock_guard lg(mutex);
+      tasks.push_back(std::move(task));
+    }
+
+    wake.notify_one();
+  }
+
+private:
+  size_t numThreads = std::max(std::thread::hardware_concurrency(), 1U);
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<std::function<void()>> tasks;
+
+  WorkerPool() {
+    for (size_t t = 0; t < numThreads; t++) {
+      std::thread([this] { Run(); }).detach();
+    }
+  }
+
+  void Run() {
+    for (;;) {
+      std::function<void()> task;
+
+      {
+        std::unique_lock lk(mutex);
+        wake.wait(lk, [&] { return !tasks.empty(); });
+        task = std::move(tasks.front());
+        tasks.pop_front();
+      }
+
+      task();
+    }
+  }
+};
+
+namespace detail {
+// Runs work on pool threads alongside calling thread.
+// Calling thread must run work as well, pool threads might be busy.
+// Destructor waits for helpers that already started, others are skipped.
+class PoolHelpers {
+public:
+  template <class F> PoolHelpers(size_t numItems, F &work) {
+    WorkerPool &pool = WorkerPool::Get();
+    const size_t numHelpers = std::min(pool.NumThreads(), numItems);
+    state->work = [&work] { work(); };
+
+    for (size_t h = 1; h < numHelpers; h++) {
+      pool.Submit([state = state] {
+        {
+          std::lock_guard lg(state->mutex);
+
+          if (state->closed) {
+            return;
+          }
+
+          state->active++;
+        }
+
+        state->work();
+
+        {
+          std::lock_guard lg(state->mutex);
+          state->active--;
+        }
+
+        state->finished.notify_all();
+      });
+    }
+  }
+
+  ~PoolHelpers() {
+    std::unique_lock lk(state->mutex);
+    state->closed = true;
+    state->finished.wait(lk, [&] { return !state->active; });
+  }
+
+private:
+  struct State {
+    std::function<void()> work;
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t active = 0;
+    bool closed = false;
+  };
+
+  std::shared_ptr<State> state = std::make_shared<State>();
+};
+} // namespace detail
+
+// Calls fc(index) for every index in [0, numItems) on a worker pool.
+// First thrown exception is rethrown on calling thread.
+template <class F> void ParallelFor(size_t numItems, F &&fc) {
+  std::atomic_size_t nextItem{0};
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  auto Worker = [&] {
+    for (size_t index; (index = nextItem++) < numItems;) {
+      try {
+        fc(index);
+      } catch (...) {
+        std::lock_guard lg(errorMutex);
+
+        if (!error) {
+          error = std::current_exception();
+        }
+
+        nextItem = numItems;
+      }
+    }
+  };
+
+  {
+    detail::PoolHelpers helpers(numItems, Worker);
+    Worker();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// Calls fc(index) for every index in [0, numItems) on a worker pool.
+// Results are passed into sink(index, result) on calling thread,
+// strictly in index order.
+// Only items within fixed window past last sunk item are processed,
+// so at most window results are held at once.
+template <class F, class S>
+void ParallelOrdered(size_t numItems, F &&fc, S &&sink) {
+  using result_type = decltype(fc(size_t{}));
+  struct Slot {
+    std::optional<result_type> result;
+    std::exception_ptr error;
+    bool done = false;
+  };
+
+  const size_t window = 2 * WorkerPool::Get().NumThreads();
+  // Ring buffer, item is stored at index % window
+  std::vector<Slot> slots(window);
+  std::mutex slotsMutex;
+  std::condition_variable changed;
+  size_t nextItem = 0;
+  size_t numSunk = 0;
+  bool cancel = false;
+
+  // Must be called under locked slotsMutex
+  auto Claim = [&]() -> std::optional<size_t> {
+    if (cancel || nextItem >= numItems || nextItem >= numSunk + window) {
+      return std::nullopt;
+    }
+
+    return nextItem++;
+  };
+
+  auto Process = [&](size_t index, std::unique_lock<std::mutex> &lk) {
+    lk.unlock();
+    Slot local;
+
+    try {
+      local.result.emplace(fc(index));
+    } catch (...) {
+      local.error = std::current_exception();
+    }
+
+    local.done = true;
+    lk.lock();
+    slots[index % window] = std::move(local);
+    changed.notify_all();
+  };
+
+  auto Worker = [&] {
+    std::unique_lock lk(slotsMutex);
+
+    for (;;) {
+      if (auto index = Claim()) {
+        Process(*index, lk);
+      } else if (cancel || nextItem >= numItems) {
+        return;
+      } else {
+        changed.wait(lk);
+      }
+    }
+  };
+
+  detail::PoolHelpers helpers(numItems, Worker);
+
+  // Stops helpers before they are awaited, when sink or fc throws
+  struct Cancel {
+    std::mutex &mutex;
+    std::condition_variable &changed;
+    bool &cancel;
+
+    ~Cancel() {
+      {
+        std::lock_guard lg(mutex);
+        cancel = true;
+      }
+
+      changed.notify_all();
+    }
+  } cancelHelpers{slotsMutex, changed, cancel};
+
+  for (size_t index = 0; index < numItems; index++) {
+    Slot current;
+
+    {
+      std::unique_lock lk(slotsMutex);
+      Slot &slot = slots[index % window];
+
+      // Calling thread works too, pool threads might be busy
+      while (!slot.done) {
+        if (auto claimed = Claim()) {
+          Process(*claimed, lk);
+        } else {
+          changed.wait(lk);
+        }
+      }
+
+      current = std::move(slot);
+      slot = Slot{};
+      numSunk++;
+    }
+
+    changed.notify_all();
+
+    if (current.error) {
+      std::rethrow_exception(current.error);
+    }
+
+    sink(index, std::move(*current.result));
+  }
+}
@@ -0,0 +1,98 @@
+/*  xenoblade_toolset common code
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+#include "spike/util/supercore.hpp"
+#include <bit>
+#include <cstring>
+#include <string_view>
+
+// XXH64
+inline uint64 HashBytes(std::string_view data, uint64 seed = 0) {
+  constexpr uint64 P1 = 11400714785074694791ULL;
+  constexpr uint64 P2 = 14029467366897019727ULL;
+  constexpr uint64 P3 = 1609587929392839161ULL;
+  constexpr uint64 P4 = 9650029242287828579ULL;
+  constexpr uint64 P5 = 2870177450012600261ULL;
+  const char *cur = data.data();
+  const char *end = cur + data.size();
+
+  auto Read64 = [](const char *ptr) {
+    uint64 value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+  };
+
+  auto Round = [](uint64 acc, uint64 input) {
+    acc += input * P2;
+    return std::rotl(acc, 31) * P1;
+  };
+
+  auto Merge = [&](uint64 acc, uint64 value) {
+    acc ^= Round(0, value);
+    return acc * P1 + P4;
+  };
+
+  uint64 hash;
+
+  if (data.size() >= 32) {
+    uint64 v[4]{seed + P1 + P2, seed + P2, seed, seed - P1};
+
+    for (; end - cur >= 32; cur += 32) {
+      for (size_t i = 0; i < 4; i++) {
+        v[i] = Round(v[i], Read64(cur + i * 8));
+      }
+    }
+
+    hash = std::rotl(v[0], 1) + std::rotl(v[1], 7) + std::rotl(v[2], 12) +
+           std::rotl(v[3], 18);
+
+    for (uint64 lane : v) {
+      hash = Merge(hash, lane);
+    }
+  } else {
+    hash = seed + P5;
+  }
+
+  hash += data.size();
+
+  for (; end - cur >= 8; cur += 8) {
+    hash ^= Round(0, Read64(cur));
+    hash = std::rotl(hash, 27) * P1 + P4;
+  }
+
+  if (end - cur >= 4) {
+    uint32 value;
+    memcpy(&value, cur, sizeof(value));
+    hash ^= value * P1;
+    hash = std::rotl(hash, 23) * P2 + P3;
+    cur += 4;
+  }
+
+  for (; cur < end; cur++) {
+    hash ^= uint8(*cur) * P5;
+    hash = std::rotl(hash, 11) * P1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= P2;
+  hash ^= hash >> 29;
+  hash *= P3;
+  hash ^= hash >> 32;
+
+  return hash;
+}
@@ -15,7 +15,7 @@
     along with this program.If not, see <https://www.gnu.org/licenses/>.
 */
 
-#include "nlohmann/json.hpp"
+#include "json_writer.hpp"
 #include "project.h"
 #include "spike/app_context.hpp"
 #include "spike/except.hpp"
@@ -87,13 +87,17 @@ void AppProcessFile(AppContext *ctx) {
   std::span<Char> chars(reinterpret_cast<Char *>(fntHeader + 1),
                         fntHeader->numChars);
 
-  nlohmann::json main;
-  auto &grid = main["grid"];
-  grid["width"] = fntHeader->gridWidth;
-  grid["height"] = fntHeader->gridHeight;
-  grid["rows"] = fntHeader->numRows;
-  grid["columns"] = fntHeader->numColumns;
-  auto &rows = main["rows"] = nlohmann::json::array();
+  JSONWriter wr(&ctx->NewFile(ctx->workingFile.ChangeExtension2("json")).str);
+  wr.BeginObject();
+  wr.Key("grid");
+  wr.BeginObject();
+  wr.Field("columns", fntHeader->numColumns);
+  wr.Field("height", fntHeader->gridHeight);
+  wr.Field("rows", fntHeader->numRows);
+  wr.Field("width", fntHeader->gridWidth);
+  wr.EndObject();
+  wr.Key("rows");
+  wr.BeginArray();
 
   size_t curCharId = 0;
 
@@ -101,21 +105,29 @@ void AppProcessFile(AppContext *ctx) {
     FByteswapper(c);
 
     if (curCharId % fntHeader->numRows == 0) {
-      rows.emplace_back(nlohmann::json::array());
+      if (curCharId) {
+        wr.EndArray();
+      }
+
+      wr.BeginArray();
     }
 
-    auto &curRow = rows.back();
-    auto &curChar = curRow.emplace_back();
     uint16 chars[2]{c.character, 0};
-    curChar["character"] = es::ToUTF8(chars);
+    wr.BeginObject();
+    wr.Field("character", es::ToUTF8(chars));
+    wr.Field("offset", c.charBegin);
     chars[0] = c.unkChracter;
-    curChar["unkChracter"] = es::ToUTF8(chars);
-    curChar["offset"] = c.charBegin;
-    curChar["width"] = c.charWidth;
+    wr.Field("unkChracter", es::ToUTF8(chars));
+    wr.Field("width", c.charWidth);
+    wr.EndObject();
 
     curCharId++;
   }
 
-  ctx->NewFile(ctx->workingFile.ChangeExtension2("json")).str << std::setw(2)
-                                                              << main;
+  if (curCharId) {
+    wr.EndArray();
+  }
+
+  wr.EndArray();
+  wr.EndObject();
 }
@@ -15,6 +15,8 @@
     along with this program.If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include "conversion_cache.hpp"
+#include "meshopt_compression.hpp"
 #include "tfbh.hpp"
 
 #include "nlohmann/json.hpp"
@@ -29,6 +31,7 @@
 #include "spike/util/endian.hpp"
 #include "xenolib/msim.hpp"
 #include <cstdlib>
+#include <sstream>
 
 using namespace fx;
 
@@ -37,9 +40,24 @@ std::string_view filters[]{
     ".wiim$",
 };
 
+static struct IM2GLTF : ReflectorBase<IM2GLTF> {
+  bool meshoptCompression = false;
+  std::string cacheDir;
+} settings;
+
+REFLECT(CLASS(IM2GLTF),
+        MEMBERNAME(meshoptCompression, "meshopt-compression", "m",
+                   ReflDesc{"Compress vertex and triangle index buffers with "
+                            "EXT_meshopt_compression."}),
+        MEMBERNAME(cacheDir, "cache-dir", "c",
+                   ReflDesc{"Folder for conversion cache, outputs of unchanged "
+                            "inputs and settings are reused. Disabled if "
+                            "empty."}), );
+
 static AppInfo_s appInfo{
     .header =
         IM2GLTF_DESC " v" IM2GLTF_VERSION ", " IM2GLTF_COPYRIGHT "Lukas Cone",
+    .settings = reinterpret_cast<ReflectorFriend *>(&settings),
     .filters = filters,
 };
 
@@ -341,6 +359,16 @@ void AppProcessFile(AppContext *ctx) {
     rdb.ReadContainer(binhBuffer, rdb.GetSize());
   }
 
+  ConversionCache cache(ctx, settings.cacheDir, "im_to_gltf",
+                        IM2GLTF_VERSION);
+  cache.HashStream(ctx->GetStream());
+  cache.Hash(binhBuffer);
+  cache.Hash(settings.meshoptCompression);
+
+  if (cache.Restore()) {
+    return;
+  }
+
   auto sHdr = reinterpret_cast<const TFBH::Header *>(binhBuffer.data());
   if (sHdr->id != TFBH::ID) {
     throw es::InvalidHeaderError(sHdr->id);
@@ -382,8 +410,13 @@ void AppProcessFile(AppContext *ctx) {
     main.extensionsRequired.emplace_back("EXT_mesh_gpu_instancing");
     main.extensionsUsed.emplace_back("EXT_mesh_gpu_instancing");
 
-    main.FinishAndSave(
-        ctx->NewFile(ctx->workingFile.ChangeExtension(".glb")).str, {});
+    if (settings.meshoptCompression) {
+      std::stringstream glb;
+      main.FinishAndSave(glb, {});
+      cache.NewFile(".glb") << Meshopt::CompressGLB(glb.str());
+    } else {
+      main.FinishAndSave(cache.NewFile(".glb"), {});
+    }
   } else {
     main.buffers.erase(main.buffers.begin());
 
@@ -391,8 +424,8 @@ void AppProcessFile(AppContext *ctx) {
       w.buffer = 0;
     }
 
-    gltf::Save(main,
-               ctx->NewFile(ctx->workingFile.ChangeExtension(".gltf")).str, {},
-               false);
+    gltf::Save(main, cache.NewFile(".gltf"), {}, false);
   }
+
+  cache.Finish();
 }
@@ -17,14 +17,17 @@
 
 #include "tfbh.hpp"
 
+#include "mesh_optimizer.hpp"
 #include "project.h"
 #include "spike/app_context.hpp"
 #include "spike/except.hpp"
 #include "spike/io/binreader_stream.hpp"
 #include "spike/io/binwritter_stream.hpp"
 #include "spike/master_printer.hpp"
+#include "spike/reflect/reflector.hpp"
 #include "spike/util/aabb.hpp"
 #include "texture.hpp"
+#include "worker_pool.hpp"
 #include "xenolib/internal/model.hpp"
 #include "xenolib/msmd.hpp"
 #include "xenolib/mtxt.hpp"
@@ -39,9 +42,19 @@ std::string_view filters[]{
     ".wismhd$",
 };
 
+static struct SMExtract : ReflectorBase<SMExtract> {
+  bool optimizeMeshes = false;
+} settings;
+
+REFLECT(CLASS(SMExtract),
+        MEMBERNAME(optimizeMeshes, "optimize-meshes", "O",
+                   ReflDesc{"Reorder triangles of map object and terrain "
+                            "index buffers for vertex cache."}), );
+
 static AppInfo_s appInfo{
     .header = SMExtract_DESC " v" SMExtract_VERSION ", " SMExtract_COPYRIGHT
                              "Lukas Cone",
+    .settings = reinterpret_cast<ReflectorFriend *>(&settings),
     .filters = filters,
 };
 
@@ -62,6 +75,24 @@ void MakeGLTFBufferV1(std::string buffer, AppExtractContext *ctx,
   auto imIndices =
       imHeader.SetArray(Stream().indices, str->indexBuffers.numItems);
 
+  // Vertex buffer of index buffer is known only by map models,
+  // so only triangle order is changed
+  if (settings.optimizeMeshes) {
+    ParallelFor(str->indexBuffers.numItems, [&](size_t index) {
+      auto &ids = str->indexBuffers.begin()[index].indices;
+      std::vector<uint32> optimized(ids.begin(), ids.end());
+
+      if (optimized.empty()) {
+        return;
+      }
+
+      const size_t numVertices =
+          *std::max_element(optimized.begin(), optimized.end()) + 1;
+      MeshOptimizer::OptimizeVertexCache(optimized, numVertices);
+      std::copy(optimized.begin(), optimized.end(), ids.begin());
+    });
+  }
+
   View(TFBH::VtViewSlot::IndexShort).offset = TotalSize();
 
   for (size_t iindex = 0; auto &b : str->indexBuffers) {
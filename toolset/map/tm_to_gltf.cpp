@@ -15,6 +15,7 @@
     along with this program.If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include "conversion_cache.hpp"
 #include "tfbh.hpp"
 
 #include "project.h"
@@ -35,9 +36,20 @@ std::string_view filters[]{
     ".witm$",
 };
 
+static struct TM2GLTF : ReflectorBase<TM2GLTF> {
+  std::string cacheDir;
+} settings;
+
+REFLECT(CLASS(TM2GLTF),
+        MEMBERNAME(cacheDir, "cache-dir", "c",
+                   ReflDesc{"Folder for conversion cache, outputs of unchanged "
+                            "inputs and settings are reused. Disabled if "
+                            "empty."}), );
+
 static AppInfo_s appInfo{
     .header =
         TM2GLTF_DESC " v" TM2GLTF_VERSION ", " TM2GLTF_COPYRIGHT "Lukas Cone",
+    .settings = reinterpret_cast<ReflectorFriend *>(&settings),
     .filters = filters,
 };
 
@@ -253,6 +265,15 @@ void AppProcessFile(AppContext *ctx) {
     rdb.ReadContainer(binhBuffer, rdb.GetSize());
   }
 
+  ConversionCache cache(ctx, settings.cacheDir, "tm_to_gltf",
+                        TM2GLTF_VERSION);
+  cache.HashStream(ctx->GetStream());
+  cache.Hash(binhBuffer);
+
+  if (cache.Restore()) {
+    return;
+  }
+
   auto sHdr = reinterpret_cast<const TFBH::Header *>(binhBuffer.data());
   if (sHdr->id != TFBH::ID) {
     throw es::InvalidHeaderError(sHdr->id);
@@ -289,6 +310,6 @@ void AppProcessFile(AppContext *ctx) {
     ProcessMeshes(main, m.get(), attrs.at(mIndex));
   }
 
-  gltf::Save(main, ctx->NewFile(ctx->workingFile.ChangeExtension(".gltf")).str,
-             {}, false);
+  gltf::Save(main, cache.NewFile(".gltf"), {}, false);
+  cache.Finish();
 }
@@ -15,6 +15,9 @@
     along with this program.If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include "conversion_cache.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshopt_compression.hpp"
 #include "nlohmann/json.hpp"
 #include "project.h"
 #include "spike/app_context.hpp"
@@ -27,10 +30,16 @@
 #include "spike/type/matrix44.hpp"
 #include "spike/util/aabb.hpp"
 #include "spike/util/endian.hpp"
+#include "worker_pool.hpp"
 #include "xenolib/bc/skel.hpp"
+#include "xenolib/internal/model.hpp"
 #include "xenolib/internal/mxmd.hpp"
 #include "xenolib/mxmd.hpp"
+#include "xenolib/mxmd/vertex_decoder.hpp"
 #include "xenolib/sar.hpp"
+#include <numeric>
+#include <sstream>
+#include <unordered_map>
 
 std::string_view filters[]{
     ".camdo$",
@@ -39,12 +48,29 @@ std::string_view filters[]{
 
 static struct MDO2GLTF : ReflectorBase<MDO2GLTF> {
   std::string fallbackSkeletonFilename;
+  bool optimizeMeshes = false;
+  bool meshoptCompression = false;
+  bool quantizeVertices = false;
+  std::string cacheDir;
 } settings;
 
 REFLECT(CLASS(MDO2GLTF),
         MEMBERNAME(fallbackSkeletonFilename, "fallback-skeleton", "f",
                    ReflDesc{
-                       "Fallback skeleton file name if none wasn't found."}), );
+                       "Fallback skeleton file name if none wasn't found."}),
+        MEMBERNAME(optimizeMeshes, "optimize-meshes", "O",
+                   ReflDesc{"Reorder triangles and vertices for vertex cache, "
+                            "overdraw and vertex fetch."}),
+        MEMBERNAME(meshoptCompression, "meshopt-compression", "m",
+                   ReflDesc{"Compress vertex and triangle index buffers with "
+                            "EXT_meshopt_compression."}),
+        MEMBERNAME(quantizeVertices, "quantize-vertices", "q",
+                   ReflDesc{"Store positions as 16 bit integers within model "
+                            "bounds, normals and tangents as 8 bit."}),
+        MEMBERNAME(cacheDir, "cache-dir", "c",
+                   ReflDesc{"Folder for conversion cache, outputs of unchanged "
+                            "inputs and settings are reused. Disabled if "
+                            "empty."}), );
 
 static AppInfo_s appInfo{
     .header = MDO2GLTF_DESC " v" MDO2GLTF_VERSION ", " MDO2GLTF_COPYRIGHT
@@ -55,7 +81,298 @@ static AppInfo_s appInfo{
 
 AppInfo_s *AppInitModule() { return &appInfo; }
 
+// Interleaved attributes of model buffer decoded in single pass.
+// Descriptors past buffer layout (morph base) are not decoded.
+struct FusedVertices {
+  std::vector<uni::FormatCodec::fvec> floats;
+  std::vector<std::string> bytes;
+
+  FusedVertices(const uni::VertexArray *vb, std::vector<uint32> &indices) {
+    auto mvb = dynamic_cast<const MDO::VertexBuffer *>(vb);
+
+    if (!mvb || mvb->layout.empty()) {
+      return;
+    }
+
+    using ut = uni::PrimitiveDescriptor::Usage_e;
+    MXMD::VertexDecoder decoder(mvb->layout);
+    const size_t numVerts = mvb->NumVertices();
+    floats.resize(decoder.NumAttributes());
+    bytes.resize(decoder.NumAttributes());
+
+    for (size_t a = 0; a < decoder.NumAttributes(); a++) {
+      switch (mvb->descs.storage.at(a).usage) {
+      case ut::Position:
+      case ut::Normal:
+      case ut::Tangent:
+      case ut::TextureCoordiante:
+        floats[a].resize(numVerts);
+        decoder.SetOutput(a, MXMD::VertexFormat::Float4, floats[a].data());
+        break;
+      case ut::VertexIndex:
+        indices.resize(numVerts);
+        decoder.SetOutput(a, MXMD::VertexFormat::UInt32, indices.data());
+        break;
+      case ut::VertexColor:
+        bytes[a].resize(numVerts * 4);
+        decoder.SetOutput(a, MXMD::VertexFormat::UInt8, bytes[a].data());
+        break;
+      default:
+        break;
+      }
+    }
+
+    auto &first = mvb->descs.storage.front();
+    decoder.Decode(first.buffer, first.stride, numVerts);
+  }
+
+  bool Decoded(size_t descIndex) const { return descIndex < floats.size(); }
+
+  // Codec fallback for descriptors that are not decoded
+  uni::FormatCodec::fvec Floats(size_t descIndex,
+                                const uni::PrimitiveDescriptor *d,
+                                size_t numVerts) {
+    if (Decoded(descIndex)) {
+      return std::move(floats[descIndex]);
+    }
+
+    uni::FormatCodec::fvec sampled;
+    d->Codec().Sample(sampled, d->RawBuffer(), numVerts, d->Stride());
+    d->Resample(sampled);
+    return sampled;
+  }
+};
+
+// Cache and overdraw ordered index buffers, vertex buffers are renumbered
+// in order of first use by their index buffers.
+// Index buffers are optimized in parallel.
+struct OptimizedMeshes {
+  std::map<size_t, std::vector<uint32>> indices;
+  std::map<size_t, MeshOptimizer::VertexRemap> remaps;
+
+  OptimizedMeshes() = default;
+  OptimizedMeshes(const MXMD::Model *model) {
+    auto prims = model->Primitives();
+    auto indexArrays = model->Indices();
+    auto vertexArrays = model->Vertices();
+
+    struct Job {
+      size_t indexArray;
+      size_t vertexArray;
+      std::vector<uint32> indices;
+    };
+
+    std::vector<Job> jobs;
+
+    for (auto p : *prims) {
+      if (size_t index = p->IndexArrayIndex(); !indices.contains(index)) {
+        indices[index];
+        jobs.emplace_back(Job{index, p->VertexArrayIndex(0), {}});
+      }
+    }
+
+    struct Positions {
+      size_t numVertices;
+      uni::FormatCodec::fvec positions;
+    };
+
+    std::map<size_t, Positions> positions;
+
+    for (auto &j : jobs) {
+      positions[j.vertexArray];
+    }
+
+    std::vector<std::pair<const size_t, Positions> *> vertexJobs;
+
+    for (auto &p : positions) {
+      vertexJobs.push_back(&p);
+    }
+
+    ParallelFor(vertexJobs.size(), [&](size_t index) {
+      auto &[vertexArray, item] = *vertexJobs[index];
+      auto vb = vertexArrays->At(vertexArray);
+      item.numVertices = vb->NumVertices();
+
+      for (auto descs = vb->Descriptors(); auto d : *descs) {
+        if (d->Usage() == uni::PrimitiveDescriptor::Usage_e::Position) {
+          d->Codec().Sample(item.positions, d->RawBuffer(), item.numVertices,
+                            d->Stride());
+          d->Resample(item.positions);
+          break;
+        }
+      }
+    });
+
+    ParallelFor(jobs.size(), [&](size_t index) {
+      Job &job = jobs[index];
+      auto ib = indexArrays->At(job.indexArray);
+      const char *raw = ib->RawIndexBuffer();
+      job.indices.resize(ib->NumIndices());
+
+      if (ib->IndexSize() == 2) {
+        auto ids = reinterpret_cast<const uint16 *>(raw);
+        std::copy_n(ids, job.indices.size(), job.indices.begin());
+      } else {
+        auto ids = reinterpret_cast<const uint32 *>(raw);
+        std::copy_n(ids, job.indices.size(), job.indices.begin());
+      }
+
+      auto &vertices = positions.at(job.vertexArray);
+      MeshOptimizer::OptimizeVertexCache(job.indices, vertices.numVertices);
+
+      if (!vertices.positions.empty()) {
+        MeshOptimizer::OptimizeOverdraw(
+            job.indices, vertices.positions.front()._arr,
+            sizeof(Vector4A16), vertices.numVertices);
+      }
+    });
+
+    // Shared vertex buffers are renumbered by all of their index buffers
+    for (auto &j : jobs) {
+      const size_t numVertices = positions.at(j.vertexArray).numVertices;
+      auto [remap, _] = remaps.try_emplace(j.vertexArray, numVertices);
+      remap->second.AddIndices(j.indices);
+      indices.at(j.indexArray) = std::move(j.indices);
+    }
+
+    for (auto &[_, remap] : remaps) {
+      remap.Finish();
+    }
+  }
+
+  const MeshOptimizer::VertexRemap *Remap(size_t vertexArray) const {
+    auto found = remaps.find(vertexArray);
+    return found == remaps.end() ? nullptr : &found->second;
+  }
+};
+
+// Positions are stored as 16 bit unsigned integers within model bounds,
+// position = quantized * scale + offset.
+// Single box is used for whole model, so every mesh node (or skin)
+// shares the same dequantization transform.
+struct PositionQuantization {
+  Vector4A16 offset;
+  Vector4A16 scale;
+  Vector4A16 invScale;
+
+  PositionQuantization(const MXMD::Model *model) {
+    auto prims = model->Primitives();
+    auto vertexArrays = model->Vertices();
+    std::vector<size_t> usedArrays;
+
+    for (auto p : *prims) {
+      usedArrays.push_back(p->VertexArrayIndex(0));
+    }
+
+    std::sort(usedArrays.begin(), usedArrays.end());
+    usedArrays.erase(std::unique(usedArrays.begin(), usedArrays.end()),
+                     usedArrays.end());
+    // Bounds of every vertex array as min, max pair
+    std::vector<uni::FormatCodec::fvec> bounds(usedArrays.size());
+
+    ParallelFor(usedArrays.size(), [&](size_t index) {
+      auto vb = vertexArrays->At(usedArrays[index]);
+
+      for (auto descs = vb->Descriptors(); auto d : *descs) {
+        if (d->Usage() == uni::PrimitiveDescriptor::Usage_e::Position) {
+          uni::FormatCodec::fvec positions;
+          d->Codec().Sample(positions, d->RawBuffer(), vb->NumVertices(),
+                            d->Stride());
+          d->Resample(positions);
+
+          if (!positions.empty()) {
+            auto aabb = GetAABB(positions);
+            bounds[index] = {aabb.min, aabb.max};
+          }
+
+          break;
+        }
+      }
+    });
+
+    uni::FormatCodec::fvec corners;
+
+    for (auto &b : bounds) {
+      corners.insert(corners.end(), b.begin(), b.end());
+    }
+
+    Vector4A16 min{};
+    Vector4A16 extent{};
+
+    if (!corners.empty()) {
+      auto aabb = GetAABB(corners);
+      min = aabb.min;
+      extent = (aabb.max - aabb.min) / 0xffff;
+    }
+
+    offset = min * Vector4A16(1, 1, 1, 0);
+    scale = Vector4A16(1, 1, 1, 1);
+    invScale = Vector4A16(1, 1, 1, 0);
+
+    for (size_t c = 0; c < 3; c++) {
+      if (extent._arr[c] > 0) {
+        scale._arr[c] = extent._arr[c];
+        invScale._arr[c] = 1 / extent._arr[c];
+      }
+    }
+  }
+
+  // Rounded and clamped, but still as floats
+  Vector4A16 Quantize(Vector4A16 position) const {
+    Vector4A16 v = (position - offset) * invScale;
+    v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
+    return Vector4A16(_mm_min_ps(_mm_max_ps(v._data, _mm_setzero_ps()),
+                                 _mm_set1_ps(0xffff)));
+  }
+
+  // Node transform of skinned mesh is ignored, dequantization is
+  // appended to inverse bind matrix instead: ibm * translate * scale
+  void Apply(es::Matrix44 &ibm) const {
+    float m[16];
+    memcpy(m, &ibm, sizeof(m));
+
+    for (size_t r = 0; r < 4; r++) {
+      m[12 + r] += m[r] * offset.X + m[4 + r] * offset.Y + m[8 + r] * offset.Z;
+
+      for (size_t c = 0; c < 3; c++) {
+        m[c * 4 + r] *= scale._arr[c];
+      }
+    }
+
+    memcpy(&ibm, m, sizeof(m));
+  }
+
+  void Apply(gltf::Node &node) const {
+    memcpy(node.translation.data(), &offset, sizeof(node.translation));
+    memcpy(node.scale.data(), &scale, sizeof(node.scale));
+  }
+};
+
+// Stream data of single converted buffer, built without touching GLTF.
+// Accessor byte offsets are relative to segment begin of their stream
+// until stitched.
+struct StreamSegments {
+  enum Type : uint8 { Indices, Vt12, Vt8, Vt4, NumTypes };
+
+  std::stringstream data[NumTypes];
+  std::vector<std::pair<Type, gltf::Accessor>> accessors;
+
+  // Returns accessor index within segments
+  std::pair<gltf::Accessor &, size_t> NewAccessor(Type type,
+                                                  size_t alignment) {
+    BinWritterRef wr(data[type]);
+    wr.ApplyPadding(alignment);
+    auto &acc = accessors.emplace_back(type, gltf::Accessor{}).second;
+    acc.byteOffset = wr.Tell();
+    return {acc, accessors.size() - 1};
+  }
+
+  BinWritterRef Writer(Type type) { return BinWritterRef(data[type]); }
+};
+
 struct MainGLTF : GLTF {
+  std::optional<PositionQuantization> quantization;
+
   void LoadSkeleton(AppContext *ctx) {
     AppContextStream skelArc;
     std::string buffer;
@@ -146,6 +463,33 @@ struct MainGLTF : GLTF {
   void ProcessSkins(const uni::Model *model, const uni::Skeleton *skel) {
     auto skins = model->Skins();
     auto bones = skel->Bones();
+    const size_t numBones = bones->Size();
+    std::vector<std::string> boneNames(numBones);
+    // Bones with same name share node of first one
+    std::vector<uint32> nameBones(numBones);
+    std::vector<int32> boneNodes(numBones, -1);
+
+    {
+      std::unordered_map<std::string_view, uint32> nodeByName;
+      std::unordered_map<std::string_view, uint32> boneByName;
+
+      for (uint32 n = 0; n < nodes.size(); n++) {
+        nodeByName.try_emplace(nodes[n].name, n);
+      }
+
+      for (uint32 b = 0; b < numBones; b++) {
+        boneNames[b] = bones->At(b)->Name();
+      }
+
+      for (uint32 b = 0; b < numBones; b++) {
+        nameBones[b] = boneByName.try_emplace(boneNames[b], b).first->second;
+
+        if (auto found = nodeByName.find(boneNames[b]);
+            found != nodeByName.end()) {
+          boneNodes[b] = found->second;
+        }
+      }
+    }
 
     auto &ibmStream = NewStream("ibms");
 
@@ -161,51 +505,48 @@ struct MainGLTF : GLTF {
       for (size_t b = 0; b < s->NumNodes(); b++) {
         es::Matrix44 mtx;
         s->GetTM(mtx, b);
-        ibmStream.wr.Write(mtx);
-        auto bone = bones->At(s->NodeIndex(b));
-        auto boneName = bone->Name();
+
+        if (quantization) {
+          es::Matrix44 ibm = mtx;
+          quantization->Apply(ibm);
+          ibmStream.wr.Write(ibm);
+        } else {
+          ibmStream.wr.Write(mtx);
+        }
+        const size_t boneIndex = s->NodeIndex(b);
+        int32 &boneNode = boneNodes.at(nameBones.at(boneIndex));
 
         sk.joints.push_back([&]() -> size_t {
-          for (auto &n : nodes) {
-            if (n.name == boneName) {
-              return std::distance(nodes.data(), &n);
-            }
+          if (boneNode >= 0) {
+            return boneNode;
           }
 
+          auto bone = bones->At(boneIndex);
           auto &nnode = nodes.emplace_back();
-          nnode.name = boneName;
+          nnode.name = boneNames[boneIndex];
+          boneNode = nodes.size() - 1;
 
           if (auto parent = bone->Parent(); parent) {
             uni::RTSValue boneTM;
             bone->GetTM(boneTM);
 
-            int32 parentId = [&]() -> int32 {
-              auto parentName = parent->Name();
-
-              for (auto &n : nodes) {
-                if (n.name == parentName) {
-                  return std::distance(nodes.data(), &n);
-                }
-              }
-
-              return -1;
-            }();
+            const int32 parentId = boneNodes.at(nameBones.at(parent->Index()));
 
             if (parentId > -1) {
               memcpy(nnode.translation.data(), &boneTM.translation,
                      sizeof(nnode.translation));
               memcpy(nnode.rotation.data(), &boneTM.rotation,
                      sizeof(nnode.rotation));
-              nodes.at(parentId).children.push_back(nodes.size() - 1);
-              return nodes.size() - 1;
+              nodes.at(parentId).children.push_back(boneNode);
+              return boneNode;
             }
           }
 
           mtx = -mtx;
           memcpy(nnode.matrix.data(), &mtx, sizeof(mtx));
 
-          scenes.front().nodes.push_back(nodes.size() - 1);
-          return nodes.size() - 1;
+          scenes.front().nodes.push_back(boneNode);
+          return boneNode;
         }());
       }
 
@@ -232,275 +573,467 @@ struct MainGLTF : GLTF {
       std::vector<uint32> indices;
       std::vector<uint32> boneWts;
       std::vector<uint32> boneIndices;
+      std::vector<MXMD::WeightRange> weightRanges;
     };
     std::map<size_t, VertexBuffer> vertexBuffers;
+    OptimizedMeshes optimized;
 
-    for (auto p : *prims) {
-      if (size_t index = p->IndexArrayIndex(); !indexBuffers.contains(index)) {
-        auto ib = indices->At(index);
-        auto &istream = GetIndexStream();
-        auto [acc, accId] = NewAccessor(istream, ib->IndexSize());
-        acc.componentType = ib->IndexSize() == 2
-                                ? gltf::Accessor::ComponentType::UnsignedShort
-                                : gltf::Accessor::ComponentType::UnsignedInt;
-        acc.count = ib->NumIndices();
-        acc.type = gltf::Accessor::Type::Scalar;
-        istream.wr.WriteBuffer(ib->RawIndexBuffer(),
-                               acc.count * ib->IndexSize());
-
-        auto Gather = [&, &acc = acc](auto *ids) {
-          using vtype =
-              std::remove_const_t<std::remove_pointer_t<decltype(ids)>>;
-          vtype minId = vtype(-1);
-          vtype maxId = 0;
-          for (size_t i = 0; i < acc.count; i++) {
-            minId = std::min(ids[i], minId);
-            maxId = std::max(ids[i], maxId);
-          }
+    if (settings.optimizeMeshes) {
+      optimized = OptimizedMeshes(model);
+    }
 
-          return std::make_pair(uint32(minId), uint32(maxId));
-        };
+    // Every index and vertex array is converted by its own task into
+    // stream segments, segments are stitched in order of first use
+    struct BufferTask {
+      size_t index;
+      bool isVertexArray;
+    };
 
-        auto [minId, maxId] = [&] {
-          if (ib->IndexSize() == 2) {
-            const uint16 *ids =
-                reinterpret_cast<const uint16 *>(ib->RawIndexBuffer());
-            return Gather(ids);
-          } else {
-            const uint32 *ids =
-                reinterpret_cast<const uint32 *>(ib->RawIndexBuffer());
-            return Gather(ids);
-          }
-        }();
+    struct BufferResult {
+      StreamSegments seg;
+      IndexBuffer indexBuffer{};
+      VertexBuffer vertexBuffer{};
+    };
+
+    std::vector<BufferTask> tasks;
 
-        indexBuffers.emplace(index, IndexBuffer{minId, maxId, uint32(accId)});
+    for (auto p : *prims) {
+      if (size_t index = p->IndexArrayIndex(); !indexBuffers.contains(index)) {
+        indexBuffers[index];
+        tasks.emplace_back(BufferTask{index, false});
       }
 
       if (size_t index = p->VertexArrayIndex(0);
           !vertexBuffers.contains(index)) {
-        gltf::Attributes attrs;
-        auto vb = vertices->At(index);
-        const size_t numVerts = vb->NumVertices();
-        std::vector<uint32> indices;
+        vertexBuffers[index];
+        tasks.emplace_back(BufferTask{index, true});
+      }
+    }
 
-        for (auto descs = vb->Descriptors(); auto d : *descs) {
-          switch (d->Usage()) {
-          case uni::PrimitiveDescriptor::Usage_e::Position: {
-            auto &vStream = GetVt12();
-            auto [acc, accId] = NewAccessor(vStream, 4);
-            acc.componentType = gltf::Accessor::ComponentType::Float;
+    auto ConvertIndices = [&](size_t index, BufferResult &result) {
+      auto &seg = result.seg;
+      auto ib = indices->At(index);
+      auto [acc, accId] =
+          seg.NewAccessor(StreamSegments::Indices, ib->IndexSize());
+      auto iwr = seg.Writer(StreamSegments::Indices);
+      acc.componentType = ib->IndexSize() == 2
+                              ? gltf::Accessor::ComponentType::UnsignedShort
+                              : gltf::Accessor::ComponentType::UnsignedInt;
+      acc.count = ib->NumIndices();
+      acc.type = gltf::Accessor::Type::Scalar;
+      auto optimizedIds = optimized.indices.find(index);
+
+      if (optimizedIds == optimized.indices.end()) {
+        iwr.WriteBuffer(ib->RawIndexBuffer(), acc.count * ib->IndexSize());
+      } else if (ib->IndexSize() == 2) {
+        for (uint32 i : optimizedIds->second) {
+          iwr.Write<uint16>(i);
+        }
+      } else {
+        iwr.WriteContainer(optimizedIds->second);
+      }
+
+      auto Gather = [&, &acc = acc](auto *ids) {
+        using vtype =
+            std::remove_const_t<std::remove_pointer_t<decltype(ids)>>;
+        vtype minId = vtype(-1);
+        vtype maxId = 0;
+        for (size_t i = 0; i < acc.count; i++) {
+          minId = std::min(ids[i], minId);
+          maxId = std::max(ids[i], maxId);
+        }
+
+        return std::make_pair(uint32(minId), uint32(maxId));
+      };
+
+      auto [minId, maxId] = [&] {
+        if (optimizedIds != optimized.indices.end()) {
+          return Gather(optimizedIds->second.data());
+        } else if (ib->IndexSize() == 2) {
+          const uint16 *ids =
+              reinterpret_cast<const uint16 *>(ib->RawIndexBuffer());
+          return Gather(ids);
+        } else {
+          const uint32 *ids =
+              reinterpret_cast<const uint32 *>(ib->RawIndexBuffer());
+          return Gather(ids);
+        }
+      }();
+
+      result.indexBuffer = IndexBuffer{minId, maxId, uint32(accId)};
+    };
+
+    auto ConvertVertices = [&](size_t index, BufferResult &result) {
+      auto &seg = result.seg;
+      gltf::Attributes attrs;
+      auto vb = vertices->At(index);
+      const size_t numVerts = vb->NumVertices();
+      std::vector<uint32> indices;
+      FusedVertices fused(vb.get(), indices);
+      const MeshOptimizer::VertexRemap *remap = optimized.Remap(index);
+
+      auto Reorder = [&](auto &items, size_t elementSize = 1) -> auto & {
+        if (remap) {
+          remap->Apply(items, elementSize);
+        }
+
+        return items;
+      };
+
+      auto descs = vb->Descriptors();
+
+      for (size_t descIndex = 0; auto d : *descs) {
+        const size_t curDesc = descIndex++;
+
+        switch (d->Usage()) {
+        case uni::PrimitiveDescriptor::Usage_e::Position: {
+          uni::FormatCodec::fvec basePosition =
+              fused.Floats(curDesc, d.get(), numVerts);
+          Reorder(basePosition);
+
+          if (quantization) {
+            auto wr = seg.Writer(StreamSegments::Vt8);
+            auto [acc, accId] = seg.NewAccessor(StreamSegments::Vt8, 2);
+            acc.componentType = gltf::Accessor::ComponentType::UnsignedShort;
             acc.type = gltf::Accessor::Type::Vec3;
             acc.count = numVerts;
             attrs["POSITION"] = accId;
 
-            uni::FormatCodec::fvec basePosition;
-            d->Codec().Sample(basePosition, d->RawBuffer(), acc.count,
-                              d->Stride());
-            d->Resample(basePosition);
+            for (auto &v : basePosition) {
+              v = quantization->Quantize(v);
+              USVector4 comp = v.Convert<uint16>();
+              wr.Write(comp);
+            }
 
             auto aabb = GetAABB(basePosition);
 
-            acc.max.insert(acc.max.begin(), aabb.max._arr, aabb.max._arr + 3);
-            acc.min.insert(acc.min.begin(), aabb.min._arr, aabb.min._arr + 3);
-
-            for (auto v : basePosition) {
-              vStream.wr.Write<Vector>(v);
-            }
+            acc.max.insert(acc.max.begin(), aabb.max._arr,
+                           aabb.max._arr + 3);
+            acc.min.insert(acc.min.begin(), aabb.min._arr,
+                           aabb.min._arr + 3);
             break;
           }
 
-          case uni::PrimitiveDescriptor::Usage_e::VertexIndex: {
-            indices.resize(numVerts);
+          auto wr = seg.Writer(StreamSegments::Vt12);
+          auto [acc, accId] = seg.NewAccessor(StreamSegments::Vt12, 4);
+          acc.componentType = gltf::Accessor::ComponentType::Float;
+          acc.type = gltf::Accessor::Type::Vec3;
+          acc.count = numVerts;
+          attrs["POSITION"] = accId;
 
-            for (size_t v = 0; v < numVerts; v++) {
-              IVector4A16 vec;
-              d->Codec().GetValue(vec, d->RawBuffer() + v * d->Stride());
-              indices.at(v) = vec.X;
-            }
+          auto aabb = GetAABB(basePosition);
+
+          acc.max.insert(acc.max.begin(), aabb.max._arr, aabb.max._arr + 3);
+          acc.min.insert(acc.min.begin(), aabb.min._arr, aabb.min._arr + 3);
+
+          for (auto v : basePosition) {
+            wr.Write<Vector>(v);
+          }
+          break;
+        }
 
+        case uni::PrimitiveDescriptor::Usage_e::VertexIndex: {
+          if (fused.Decoded(curDesc)) {
             break;
           }
 
-          case uni::PrimitiveDescriptor::Usage_e::Normal: {
-            auto &stream = GetVt8();
-            auto [acc, index] = NewAccessor(stream, 2);
-            acc.count = numVerts;
-            acc.componentType = gltf::Accessor::ComponentType::Short;
-            acc.normalized = true;
-            acc.type = gltf::Accessor::Type::Vec3;
-            attrs["NORMAL"] = index;
-
-            uni::FormatCodec::fvec sampled;
-            d->Codec().Sample(sampled, d->RawBuffer(), numVerts, d->Stride());
-            d->Resample(sampled);
-
-            for (auto v : sampled) {
-              v *= Vector4A16(1, 1, 1, 0);
-              v.Normalize() *= 0x7fff;
-              v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
-              auto comp = v.Convert<int16>();
-              stream.wr.Write(comp);
-            }
+          indices.resize(numVerts);
 
-            break;
+          for (size_t v = 0; v < numVerts; v++) {
+            IVector4A16 vec;
+            d->Codec().GetValue(vec, d->RawBuffer() + v * d->Stride());
+            indices.at(v) = vec.X;
           }
 
-          case uni::PrimitiveDescriptor::Usage_e::Tangent: {
-            auto &stream = GetVt8();
-            auto [acc, index] = NewAccessor(stream, 2);
-            acc.count = numVerts;
-            acc.componentType = gltf::Accessor::ComponentType::Short;
-            acc.normalized = true;
-            acc.type = gltf::Accessor::Type::Vec4;
-            attrs["TANGENT"] = index;
-
-            uni::FormatCodec::fvec sampled;
-            d->Codec().Sample(sampled, d->RawBuffer(), numVerts, d->Stride());
-            d->Resample(sampled);
-
-            for (auto v : sampled) {
-              v = (v * Vector4A16(1, 1, 1, 0)).Normalized() +
-                  v * Vector4A16(0, 0, 0, 1);
-              v *= 0x7fff;
-              v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
-              auto comp = v.Convert<int16>();
-              stream.wr.Write(comp);
+          break;
+        }
+
+        case uni::PrimitiveDescriptor::Usage_e::Normal: {
+          const bool packed = quantization.has_value();
+          const auto type = packed ? StreamSegments::Vt4 : StreamSegments::Vt8;
+          auto wr = seg.Writer(type);
+          auto [acc, index] = seg.NewAccessor(type, packed ? 1 : 2);
+          acc.count = numVerts;
+          acc.componentType = packed ? gltf::Accessor::ComponentType::Byte
+                                     : gltf::Accessor::ComponentType::Short;
+          acc.normalized = true;
+          acc.type = gltf::Accessor::Type::Vec3;
+          attrs["NORMAL"] = index;
+
+          uni::FormatCodec::fvec sampled =
+              fused.Floats(curDesc, d.get(), numVerts);
+          Reorder(sampled);
+
+          for (auto v : sampled) {
+            v *= Vector4A16(1, 1, 1, 0);
+            v.Normalize() *= packed ? 0x7f : 0x7fff;
+            v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
+
+            if (packed) {
+              wr.Write(v.Convert<int8>());
+            } else {
+              wr.Write(v.Convert<int16>());
             }
+          }
 
-            break;
+          break;
+        }
+
+        case uni::PrimitiveDescriptor::Usage_e::Tangent: {
+          const bool packed = quantization.has_value();
+          const auto type = packed ? StreamSegments::Vt4 : StreamSegments::Vt8;
+          auto wr = seg.Writer(type);
+          auto [acc, index] = seg.NewAccessor(type, packed ? 1 : 2);
+          acc.count = numVerts;
+          acc.componentType = packed ? gltf::Accessor::ComponentType::Byte
+                                     : gltf::Accessor::ComponentType::Short;
+          acc.normalized = true;
+          acc.type = gltf::Accessor::Type::Vec4;
+          attrs["TANGENT"] = index;
+
+          uni::FormatCodec::fvec sampled =
+              fused.Floats(curDesc, d.get(), numVerts);
+          Reorder(sampled);
+
+          for (auto v : sampled) {
+            v = (v * Vector4A16(1, 1, 1, 0)).Normalized() +
+                v * Vector4A16(0, 0, 0, 1);
+            v *= packed ? 0x7f : 0x7fff;
+            v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
+
+            if (packed) {
+              wr.Write(v.Convert<int8>());
+            } else {
+              wr.Write(v.Convert<int16>());
+            }
           }
 
-          case uni::PrimitiveDescriptor::Usage_e::TextureCoordiante: {
-            uni::FormatCodec::fvec sampled;
-            d->Codec().Sample(sampled, d->RawBuffer(), numVerts, d->Stride());
-            d->Resample(sampled);
-            auto aabb = GetAABB(sampled);
-            auto &max = aabb.max;
-            auto &min = aabb.min;
-            const bool uv16 = max <= 1.f && min >= -1.f;
-            auto &stream = uv16 ? GetVt4() : GetVt8();
-            auto [acc, index] = NewAccessor(stream, 4);
-            acc.count = numVerts;
-            acc.type = gltf::Accessor::Type::Vec2;
-            auto coordName = "TEXCOORD_" + std::to_string(d->Index());
-            attrs[coordName] = index;
-
-            auto vertWr = stream.wr;
-
-            if (uv16) {
-              if (min >= 0.f) {
-                acc.componentType =
-                    gltf::Accessor::ComponentType::UnsignedShort;
-                acc.normalized = true;
-
-                for (auto &v : sampled) {
-                  v.Normalize() *= 0xffff;
-                  v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
-                  USVector4 comp = v.Convert<uint16>();
-                  vertWr.Write(USVector2(comp));
-                }
-              } else {
-                acc.componentType = gltf::Accessor::ComponentType::Short;
-                acc.normalized = true;
-
-                for (auto &v : sampled) {
-                  v.Normalize() *= 0x7fff;
-                  v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
-                  SVector4 comp = v.Convert<int16>();
-                  vertWr.Write(SVector2(comp));
-                }
+          break;
+        }
+
+        case uni::PrimitiveDescriptor::Usage_e::TextureCoordiante: {
+          uni::FormatCodec::fvec sampled =
+              fused.Floats(curDesc, d.get(), numVerts);
+          Reorder(sampled);
+          auto aabb = GetAABB(sampled);
+          auto &max = aabb.max;
+          auto &min = aabb.min;
+          const bool uv16 = max <= 1.f && min >= -1.f;
+          const auto type = uv16 ? StreamSegments::Vt4 : StreamSegments::Vt8;
+          auto [acc, index] = seg.NewAccessor(type, 4);
+          acc.count = numVerts;
+          acc.type = gltf::Accessor::Type::Vec2;
+          auto coordName = "TEXCOORD_" + std::to_string(d->Index());
+          attrs[coordName] = index;
+
+          auto vertWr = seg.Writer(type);
+
+          if (uv16) {
+            if (min >= 0.f) {
+              acc.componentType =
+                  gltf::Accessor::ComponentType::UnsignedShort;
+              acc.normalized = true;
+
+              for (auto &v : sampled) {
+                v.Normalize() *= 0xffff;
+                v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
+                USVector4 comp = v.Convert<uint16>();
+                vertWr.Write(USVector2(comp));
               }
             } else {
-              acc.componentType = gltf::Accessor::ComponentType::Float;
+              acc.componentType = gltf::Accessor::ComponentType::Short;
+              acc.normalized = true;
 
               for (auto &v : sampled) {
-                vertWr.Write(Vector2(v));
+                v.Normalize() *= 0x7fff;
+                v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
+                SVector4 comp = v.Convert<int16>();
+                vertWr.Write(SVector2(comp));
               }
             }
-
-            break;
-          }
-
-          case uni::PrimitiveDescriptor::Usage_e::VertexColor: {
-            auto &stream = GetVt4();
-            auto [acc, index] = NewAccessor(stream, 1);
-            acc.count = numVerts;
-            acc.componentType = gltf::Accessor::ComponentType::UnsignedByte;
-            acc.normalized = true;
-            acc.type = gltf::Accessor::Type::Vec4;
-            auto coordName = "COLOR_" + std::to_string(d->Index());
-            attrs[coordName] = index;
-            uni::FormatCodec::ivec sampled;
-            d->Codec().Sample(sampled, d->RawBuffer(), numVerts, d->Stride());
+          } else {
+            acc.componentType = gltf::Accessor::ComponentType::Float;
 
             for (auto &v : sampled) {
-              stream.wr.Write(v.Convert<uint8>());
+              vertWr.Write(Vector2(v));
             }
+          }
 
+          break;
+        }
+
+        case uni::PrimitiveDescriptor::Usage_e::VertexColor: {
+          auto wr = seg.Writer(StreamSegments::Vt4);
+          auto [acc, index] = seg.NewAccessor(StreamSegments::Vt4, 1);
+          acc.count = numVerts;
+          acc.componentType = gltf::Accessor::ComponentType::UnsignedByte;
+          acc.normalized = true;
+          acc.type = gltf::Accessor::Type::Vec4;
+          auto coordName = "COLOR_" + std::to_string(d->Index());
+          attrs[coordName] = index;
+
+          if (fused.Decoded(curDesc)) {
+            wr.WriteContainer(Reorder(fused.bytes[curDesc], 4));
             break;
           }
 
-          default:
-            break;
+          uni::FormatCodec::ivec sampled;
+          d->Codec().Sample(sampled, d->RawBuffer(), numVerts, d->Stride());
+          Reorder(sampled);
+
+          for (auto &v : sampled) {
+            wr.Write(v.Convert<uint8>());
           }
+
+          break;
         }
 
-        vertexBuffers.emplace(
-            index,
-            VertexBuffer{
-                std::move(attrs), {}, numVerts, std::move(indices), {}, {}});
+        default:
+          break;
+        }
       }
-    }
+
+      if (!indices.empty()) {
+        Reorder(indices);
+      }
+
+      result.vertexBuffer = VertexBuffer{
+          std::move(attrs), {}, numVerts, std::move(indices), {}, {}, {}};
+    };
+
+    ParallelOrdered(
+        tasks.size(),
+        [&](size_t taskIndex) {
+          const BufferTask &task = tasks[taskIndex];
+          BufferResult result;
+
+          if (task.isVertexArray) {
+            ConvertVertices(task.index, result);
+          } else {
+            ConvertIndices(task.index, result);
+          }
+
+          return result;
+        },
+        [&](size_t taskIndex, BufferResult result) {
+          const BufferTask &task = tasks[taskIndex];
+          const uint32 firstAccessor = Stitch(result.seg);
+
+          if (task.isVertexArray) {
+            for (auto &[_, accId] : result.vertexBuffer.main) {
+              accId += firstAccessor;
+            }
+
+            vertexBuffers.at(task.index) = std::move(result.vertexBuffer);
+          } else {
+            result.indexBuffer.accIndex += firstAccessor;
+            indexBuffers.at(task.index) = result.indexBuffer;
+          }
+        });
 
     if (auto morphs = model->MorphTargets()) {
+      // Decoded once per vertex buffer, shared by all of its morphs
+      std::map<size_t, uni::FormatCodec::fvec> baseNormals;
+
       for (auto m : *morphs) {
-        auto &vtBuff = vertexBuffers.at(m->TargetVertexArrayIndex());
-        gltf::Accessor baseAcc{};
-        baseAcc.componentType = gltf::Accessor::ComponentType::Float;
-        baseAcc.type = gltf::Accessor::Type::Vec3;
-        baseAcc.count = vtBuff.numVertices;
-
-        if (vtBuff.morphs.empty()) {
-          gltf::Attributes morphAttrs;
-          morphAttrs["POSITION"] = accessors.size();
-          baseAcc.max.resize(3);
-          baseAcc.min.resize(3);
-          accessors.emplace_back(baseAcc);
-          baseAcc.max.resize(0);
-          baseAcc.min.resize(0);
-
-          vtBuff.morphs.insert(vtBuff.morphs.begin(),
-                               model->MorphTargetNames().size(), morphAttrs);
+        const size_t target = m->TargetVertexArrayIndex();
+
+        if (m->NumVertices() == 0 || baseNormals.contains(target)) {
+          continue;
+        }
+
+        auto &data = baseNormals[target];
+        auto vts = vertices->At(target);
+
+        for (auto descs = vts->Descriptors(); auto d : *descs) {
+          if (d->Usage() == uni::PrimitiveDescriptor::Usage_e::Normal) {
+            d->Codec().Sample(data, d->RawBuffer(), vts->NumVertices(),
+                              d->Stride());
+            d->Resample(data);
+            break;
+          }
         }
+      }
+
+      // Sparse stream data of single morph, accessor offsets are relative
+      // to data begin
+      struct MorphSegment {
+        std::string data;
+        gltf::Accessor position{};
+        std::optional<gltf::Accessor> normal;
+      };
+
+      // Workers only read these
+      const auto &constBuffers = vertexBuffers;
+      const auto &constNormals = baseNormals;
+
+      auto MakeSegment = [&](size_t morphIndex) {
+        auto m = morphs->At(morphIndex);
+        MorphSegment segment;
 
         if (m->NumVertices() == 0) {
-          continue;
+          return segment;
         }
 
-        auto &vStream = GetSparseStream();
+        std::stringstream str;
+        BinWritterRef wr(str);
+        gltf::Accessor &baseAcc = segment.position;
+        baseAcc.componentType = gltf::Accessor::ComponentType::Float;
+        baseAcc.type = gltf::Accessor::Type::Vec3;
+        const size_t target = m->TargetVertexArrayIndex();
+        baseAcc.count = constBuffers.at(target).numVertices;
+
         auto &sparse = baseAcc.sparse;
         sparse.count = m->NumVertices();
-        sparse.values.bufferView = vStream.slot;
-        sparse.indices.bufferView = vStream.slot;
         sparse.indices.componentType =
             gltf::Accessor::ComponentType::UnsignedShort;
 
         uni::Element<const uni::PrimitiveDescriptor> normals;
         std::vector<uint16> indices;
+        auto morphRemap = optimized.Remap(target);
+        auto NewIndex = [&](uint32 index) {
+          return morphRemap ? morphRemap->NewIndex(index) : index;
+        };
+
+        // Sparse indices must be ascending, entries are sorted by
+        // renumbered vertex
+        std::vector<uint32> sparseOrder(sparse.count);
+        std::iota(sparseOrder.begin(), sparseOrder.end(), 0);
+
+        for (auto descs = m->Descriptors(); auto d : *descs) {
+          if (morphRemap &&
+              d->Usage() == uni::PrimitiveDescriptor::Usage_e::VertexIndex) {
+            uni::FormatCodec::ivec data;
+            d->Codec().Sample(data, d->RawBuffer(), sparse.count, d->Stride());
+            std::stable_sort(sparseOrder.begin(), sparseOrder.end(),
+                             [&](uint32 a, uint32 b) {
+                               return NewIndex(data[a].x) <
+                                      NewIndex(data[b].x);
+                             });
+            break;
+          }
+        }
 
         for (auto descs = m->Descriptors(); auto d : *descs) {
           switch (d->Usage()) {
           case uni::PrimitiveDescriptor::Usage_e::PositionDelta: {
-            vStream.wr.ApplyPadding(4);
-            sparse.values.byteOffset = vStream.wr.Tell();
+            wr.ApplyPadding(4);
+            sparse.values.byteOffset = wr.Tell();
 
             uni::FormatCodec::fvec deltaPosition;
             d->Codec().Sample(deltaPosition, d->RawBuffer(), sparse.count,
                               d->Stride());
             d->Resample(deltaPosition);
 
-            for (auto v : deltaPosition) {
-              vStream.wr.Write<Vector>(v);
+            // Deltas are in quantized space of base positions
+            if (quantization) {
+              for (auto &v : deltaPosition) {
+                v *= quantization->invScale;
+              }
+            }
+
+            for (uint32 i : sparseOrder) {
+              wr.Write<Vector>(deltaPosition[i]);
             }
 
             auto aabb = GetAABB(deltaPosition);
@@ -515,16 +1048,16 @@ struct MainGLTF : GLTF {
           }
 
           case uni::PrimitiveDescriptor::Usage_e::VertexIndex: {
-            vStream.wr.ApplyPadding(2);
-            sparse.indices.byteOffset = vStream.wr.Tell();
+            wr.ApplyPadding(2);
+            sparse.indices.byteOffset = wr.Tell();
 
             uni::FormatCodec::ivec data;
             d->Codec().Sample(data, d->RawBuffer(), sparse.count, d->Stride());
             indices.reserve(sparse.count);
 
-            for (auto v : data) {
-              indices.push_back(v.x);
-              vStream.wr.Write<uint16>(v.X);
+            for (uint32 i : sparseOrder) {
+              indices.push_back(data[i].x);
+              wr.Write<uint16>(NewIndex(data[i].x));
             }
 
             break;
@@ -539,64 +1072,103 @@ struct MainGLTF : GLTF {
           }
         }
 
-        gltf::Attributes morphAttrs;
-        morphAttrs["POSITION"] = accessors.size();
-        accessors.emplace_back(baseAcc);
+        auto &data = constNormals.at(target);
 
-        if (normals) {
-          baseAcc.min.clear();
-          baseAcc.max.clear();
-          baseAcc.componentType = gltf::Accessor::ComponentType::Byte;
-          baseAcc.normalized = true;
-          sparse.values.byteOffset = vStream.wr.Tell();
+        if (normals && !data.empty()) {
+          gltf::Accessor normAcc = baseAcc;
+          normAcc.min.clear();
+          normAcc.max.clear();
+          normAcc.componentType = gltf::Accessor::ComponentType::Byte;
+          normAcc.normalized = true;
+          normAcc.sparse.values.byteOffset = wr.Tell();
 
           uni::FormatCodec::fvec sampled;
           normals->Codec().Sample(sampled, normals->RawBuffer(), sparse.count,
                                   normals->Stride());
           normals->Resample(sampled);
-
-          auto vts = vertices->At(m->TargetVertexArrayIndex());
           std::vector<uint16> normIndices;
 
-          for (auto descs = vts->Descriptors(); auto d : *descs) {
-            if (d->Usage() == uni::PrimitiveDescriptor::Usage_e::Normal) {
-              uni::FormatCodec::fvec data;
-              d->Codec().Sample(data, d->RawBuffer(), vts->NumVertices(),
-                                d->Stride());
-              d->Resample(data);
-
-              for (int32 i = 0; i < sparse.count; i++) {
-                auto v = sampled[i];
-                v -= data[indices[i]] * Vector4A16(1, 1, 1, 0);
-                v *= Vector4A16(0x7f, 0x7f, 0x7f, 0);
-                v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
-
-                if (v != Vector4A16{}) {
-                  normIndices.push_back(indices[i]);
-                  auto comp = Vector(v).Convert<int8>();
-                  vStream.wr.Write(comp);
-                }
-              }
+          for (int32 i = 0; i < sparse.count; i++) {
+            auto v = sampled[sparseOrder[i]];
+            v -= data[indices[i]] * Vector4A16(1, 1, 1, 0);
+            v *= Vector4A16(0x7f, 0x7f, 0x7f, 0);
+            v = Vector4A16(_mm_round_ps(v._data, _MM_ROUND_NEAREST));
 
-              break;
+            if (v != Vector4A16{}) {
+              normIndices.push_back(NewIndex(indices[i]));
+              auto comp = Vector(v).Convert<int8>();
+              wr.Write(comp);
             }
           }
 
           if (!normIndices.empty()) {
             if (normIndices.size() != indices.size()) {
-              vStream.wr.ApplyPadding(2);
-              sparse.indices.byteOffset = vStream.wr.Tell();
-              sparse.count = normIndices.size();
-              vStream.wr.WriteContainer(normIndices);
+              wr.ApplyPadding(2);
+              normAcc.sparse.indices.byteOffset = wr.Tell();
+              normAcc.sparse.count = normIndices.size();
+              wr.WriteContainer(normIndices);
             }
 
-            morphAttrs["NORMAL"] = accessors.size();
-            accessors.emplace_back(std::move(baseAcc));
+            segment.normal = std::move(normAcc);
           }
         }
 
-        vtBuff.morphs.at(m->Index()) = std::move(morphAttrs);
-      }
+        segment.data = str.str();
+        return segment;
+      };
+
+      // Segments are built in parallel and appended in morph order
+      ParallelOrdered(
+          morphs->Size(), MakeSegment,
+          [&](size_t morphIndex, MorphSegment segment) {
+            auto m = morphs->At(morphIndex);
+            auto &vtBuff = vertexBuffers.at(m->TargetVertexArrayIndex());
+
+            if (vtBuff.morphs.empty()) {
+              gltf::Accessor baseAcc{};
+              baseAcc.componentType = gltf::Accessor::ComponentType::Float;
+              baseAcc.type = gltf::Accessor::Type::Vec3;
+              baseAcc.count = vtBuff.numVertices;
+              baseAcc.max.resize(3);
+              baseAcc.min.resize(3);
+
+              gltf::Attributes morphAttrs;
+              morphAttrs["POSITION"] = accessors.size();
+              accessors.emplace_back(baseAcc);
+
+              vtBuff.morphs.insert(vtBuff.morphs.begin(),
+                                   model->MorphTargetNames().size(),
+                                   morphAttrs);
+            }
+
+            if (m->NumVertices() == 0) {
+              return;
+            }
+
+            auto &vStream = GetSparseStream();
+            vStream.wr.ApplyPadding(4);
+            const size_t segmentBegin = vStream.wr.Tell();
+            vStream.wr.WriteContainer(segment.data);
+
+            auto AddAccessor = [&](gltf::Accessor &acc) {
+              auto &sparse = acc.sparse;
+              sparse.values.bufferView = vStream.slot;
+              sparse.indices.bufferView = vStream.slot;
+              sparse.values.byteOffset += segmentBegin;
+              sparse.indices.byteOffset += segmentBegin;
+              accessors.emplace_back(std::move(acc));
+              return accessors.size() - 1;
+            };
+
+            gltf::Attributes morphAttrs;
+            morphAttrs["POSITION"] = AddAccessor(segment.position);
+
+            if (segment.normal) {
+              morphAttrs["NORMAL"] = AddAccessor(*segment.normal);
+            }
+
+            vtBuff.morphs.at(m->Index()) = std::move(morphAttrs);
+          });
     }
 
     union MeshKey {
@@ -633,43 +1205,11 @@ struct MainGLTF : GLTF {
       prim.attributes = vb.main;
       prim.targets = vb.morphs;
 
-      if (auto wts = model->WeightSamplers()) {
+      if (model->WeightSamplers()) {
         prim.attributes["JOINTS_0"] = -p->VertexArrayIndex(0) - 1;
         prim.attributes["WEIGHTS_0"] = -p->VertexArrayIndex(0) - 1;
-
-        auto wt = wts->Get(p.get());
-        std::vector<uint32> pIndices;
-        pIndices.reserve(iBuffer.maxId - iBuffer.minId);
-
-        for (uint32 m = iBuffer.minId; m <= iBuffer.maxId; m++) {
-          pIndices.push_back(vb.indices.at(m));
-        }
-
-        std::vector<uint32> boneWeights;
-        std::vector<uint32> boneIndices;
-
-        wt->Resample(pIndices, boneIndices, boneWeights);
-
-        if (vb.boneIndices.empty()) {
-          vb.boneIndices.resize(vb.numVertices);
-          vb.boneWts.resize(vb.numVertices);
-        }
-
-        for (size_t i = 0; i < pIndices.size(); i++) {
-          auto &cwt = vb.boneWts.at(iBuffer.minId + i);
-          auto &cbn = vb.boneIndices.at(iBuffer.minId + i);
-          if (cwt == 0) {
-            cwt = boneWeights.at(i);
-            cbn = boneIndices.at(i);
-          } else {
-            if (cbn != boneIndices.at(i)) {
-              assert(false);
-            }
-            if (cwt != boneWeights.at(i)) {
-              assert(false);
-            }
-          }
-        }
+        vb.weightRanges.emplace_back(
+            MXMD::WeightRange{p.get(), iBuffer.minId, iBuffer.maxId});
       }
 
       auto &lodMesh =
@@ -684,7 +1224,18 @@ struct MainGLTF : GLTF {
 
     std::map<size_t, size_t> wtsMap;
 
-    if (model->WeightSamplers()) {
+    if (auto wts = model->WeightSamplers()) {
+      std::vector<VertexBuffer *> toResolve;
+
+      for (auto &[_, vb] : vertexBuffers) {
+        toResolve.push_back(&vb);
+      }
+
+      ParallelFor(toResolve.size(), [&](size_t index) {
+        auto &vb = *toResolve[index];
+        wts->Resolve(vb.indices, vb.weightRanges, vb.boneIndices, vb.boneWts);
+      });
+
       for (auto &[vbId, vb] : vertexBuffers) {
         auto &stream = GetVt4();
         auto [acc, index] = NewAccessor(stream, 4);
@@ -720,6 +1271,8 @@ struct MainGLTF : GLTF {
       mNode.mesh = meshes.size();
       if (!skins.empty()) {
         mNode.skin = 0;
+      } else if (quantization) {
+        quantization->Apply(mNode);
       }
       meshes.emplace_back(std::move(mesh));
       scenes.back().nodes.push_back(nodes.size());
@@ -727,6 +1280,47 @@ struct MainGLTF : GLTF {
     }
   }
 
+  GLTFStream &GetStream(StreamSegments::Type type) {
+    switch (type) {
+    case StreamSegments::Indices:
+      return GetIndexStream();
+    case StreamSegments::Vt12:
+      return GetVt12();
+    case StreamSegments::Vt8:
+      return GetVt8();
+    default:
+      return GetVt4();
+    }
+  }
+
+  // Appends segments to their streams, returns index of first accessor
+  uint32 Stitch(StreamSegments &segments) {
+    size_t begins[StreamSegments::NumTypes]{};
+
+    for (uint32 t = 0; t < StreamSegments::NumTypes; t++) {
+      const std::string data = segments.data[t].str();
+
+      if (data.empty()) {
+        continue;
+      }
+
+      auto &stream = GetStream(StreamSegments::Type(t));
+      stream.wr.ApplyPadding(4);
+      begins[t] = stream.wr.Tell();
+      stream.wr.WriteContainer(data);
+    }
+
+    const uint32 firstAccessor = accessors.size();
+
+    for (auto &[type, acc] : segments.accessors) {
+      acc.bufferView = GetStream(type).slot;
+      acc.byteOffset += begins[type];
+      accessors.emplace_back(std::move(acc));
+    }
+
+    return firstAccessor;
+  }
+
   GLTFStream &GetIndexStream() {
     if (indexStream < 0) {
       auto &str = NewStream("indices");
@@ -807,6 +1401,33 @@ void AppProcessFile(AppContext *ctx) {
     }
   }
 
+  ConversionCache cache(ctx, settings.cacheDir, "mdo_to_gltf",
+                        MDO2GLTF_VERSION);
+  {
+    const std::string pathNoExt(ctx->workingFile.GetFullPathNoExt());
+    const std::string fallbackSkeleton =
+        std::string(ctx->workingFile.GetFolder()) +
+        settings.fallbackSkeletonFilename;
+    cache.HashStream(ctx->GetStream());
+    cache.HashFile(pathNoExt + ".wismt");
+    cache.HashFile(pathNoExt + ".arc");
+    cache.HashFile(pathNoExt + ".chr");
+
+    if (!settings.fallbackSkeletonFilename.empty()) {
+      cache.HashFile(fallbackSkeleton + ".arc");
+      cache.HashFile(fallbackSkeleton + ".chr");
+    }
+
+    cache.Hash(settings.fallbackSkeletonFilename);
+    cache.Hash(settings.optimizeMeshes);
+    cache.Hash(settings.meshoptCompression);
+    cache.Hash(settings.quantizeVertices);
+
+    if (cache.Restore()) {
+      return;
+    }
+  }
+
   MainGLTF main;
   main.LoadSkeleton(ctx);
   main.extensionsRequired.emplace_back("KHR_mesh_quantization");
@@ -825,9 +1446,21 @@ void AppProcessFile(AppContext *ctx) {
 
   const MXMD::Model *model = mxmd;
   const uni::Skeleton *skeleton = mxmd;
+
+  if (settings.quantizeVertices) {
+    main.quantization.emplace(model);
+  }
+
   main.ProcessSkins(model, skeleton);
   main.ProcessMeshes(model);
 
-  main.FinishAndSave(ctx->NewFile(ctx->workingFile.ChangeExtension(".glb")).str,
-                     {});
+  if (settings.meshoptCompression) {
+    std::stringstream glb;
+    main.FinishAndSave(glb, {});
+    cache.NewFile(".glb") << Meshopt::CompressGLB(glb.str());
+  } else {
+    main.FinishAndSave(cache.NewFile(".glb"), {});
+  }
+
+  cache.Finish();
 }
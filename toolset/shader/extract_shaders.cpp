@@ -15,6 +15,7 @@
     along with this program.If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include "content_registry.hpp"
 #include "latte/latte_disassembler.h"
 #include "project.h"
 #include "spike/app_context.hpp"
@@ -32,10 +33,22 @@ std::string_view filters[]{
     ".cashd$",
 };
 
+static struct SHDExtract : ReflectorBase<SHDExtract> {
+  bool dedupShaders = false;
+} settings;
+
+REFLECT(CLASS(SHDExtract),
+        MEMBERNAME(dedupShaders, "dedup-shaders", "d",
+                   ReflDesc{"Disassemble identical shaders only once per "
+                            "batch, other shaders get .ref file with path to "
+                            "it, relative to .ref file and without "
+                            "extension."}), );
+
 static AppInfo_s appInfo{
     .filteredLoad = true,
     .header = SHDExtract_DESC " v" SHDExtract_VERSION ", " SHDExtract_COPYRIGHT
                               "Lukas Cone",
+    .settings = reinterpret_cast<ReflectorFriend *>(&settings),
     .filters = filters,
 };
 
@@ -64,7 +77,22 @@ REFLECT(ENUMERATION(gx2::ShaderVarType), ENUM_MEMBERNAME(Void, void),
         ENUM_MEMBER(dmat3x4), ENUM_MEMBER(dmat4x2), ENUM_MEMBER(dmat4x3),
         ENUM_MEMBER(dmat4), )
 
-void ExtractMTHS(char *buffer, AppContext *ctx, std::string_view name) {
+void ExtractMTHS(char *buffer, size_t size, AppContext *ctx,
+                 std::string_view name) {
+  if (settings.dedupShaders) {
+    // Hashed before fixups, they make buffer address dependent
+    static ContentRegistry registry;
+    // Owner outputs are <name>.vert and <name>.frag
+    const std::string owner = ContentOwner(ctx, name);
+
+    if (auto original = registry.Claim({buffer, size}, owner)) {
+      auto ectx = ctx->ExtractContext();
+      ectx->NewFile(std::string(name) + ".ref");
+      ectx->SendData(ContentReference(ctx, *original));
+      return;
+    }
+  }
+
   auto hdr = reinterpret_cast<MTHS::Header *>(buffer);
   ProcessClass(*hdr);
   std::stringstream output;
@@ -179,7 +207,7 @@ void ExtractMXMD(BinReaderRef rd, AppContext *ctx) {
                      for (size_t index = 0; auto &s : hdr.shaders->shaders) {
                        // todo name from material + lod
                        auto idx = std::to_string(index++);
-                       ExtractMTHS(s.data.items, ctx, idx);
+                       ExtractMTHS(s.data.items, s.data.numItems, ctx, idx);
                      }
                    }
                  },
@@ -199,7 +227,8 @@ void AppProcessFile(AppContext *ctx) {
 
   if (id == MTHS::ID) {
     std::string buffer = ctx->GetBuffer();
-    ExtractMTHS(buffer.data(), ctx, ctx->workingFile.GetFilename());
+    ExtractMTHS(buffer.data(), buffer.size(), ctx,
+                ctx->workingFile.GetFilename());
   } else if (id == MXMD::ID || id == MXMD::ID_BIG) {
     BinReaderRef rd(ctx->GetStream());
     ExtractMXMD(rd, ctx);
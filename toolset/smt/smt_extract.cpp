@@ -15,10 +15,12 @@
     along with this program.If not, see <https://www.gnu.org/licenses/>.
 */
 
+#include "content_registry.hpp"
 #include "project.h"
 #include "spike/app_context.hpp"
 #include "spike/except.hpp"
 #include "spike/io/binreader_stream.hpp"
+#include "spike/reflect/reflector.hpp"
 #include "texture.hpp"
 #include "xenolib/drsm.hpp"
 #include "xenolib/internal/mxmd.hpp"
@@ -35,10 +37,21 @@ std::string_view filters[]{
 static constexpr bool DEV_EXTRACT_MODEL = true;
 static constexpr bool DEV_EXTRACT_ALL = false;
 
+static struct SMTExtract : ReflectorBase<SMTExtract> {
+  bool dedupShaders = false;
+} settings;
+
+REFLECT(CLASS(SMTExtract),
+        MEMBERNAME(dedupShaders, "dedup-shaders", "d",
+                   ReflDesc{"Extract identical shader streams only once per "
+                            "batch, other files get .ref file with path to "
+                            "it, relative to .ref file."}), );
+
 static AppInfo_s appInfo{
     .filteredLoad = true,
     .header = SMTExtract_DESC " v" SMTExtract_VERSION ", " SMTExtract_COPYRIGHT
                               "Lukas Cone",
+    .settings = reinterpret_cast<ReflectorFriend *>(&settings),
     .filters = filters,
 };
 
@@ -98,10 +111,23 @@ void TryExtractDRSM(AppContext *ctx) {
     }
 
     {
-      ectx->NewFile("shaders.wishp");
+      static ContentRegistry shaderRegistry;
       auto &entry = entries[resources->shaderStreamEntryIndex];
       std::string_view shStream(main + entry.offset, entry.size);
-      ectx->SendData(shStream);
+      const std::string owner = ContentOwner(ctx, "shaders.wishp");
+      std::optional<std::string> original;
+
+      if (settings.dedupShaders) {
+        original = shaderRegistry.Claim(shStream, owner);
+      }
+
+      if (original) {
+        ectx->NewFile("shaders.wishp.ref");
+        ectx->SendData(ContentReference(ctx, *original));
+      } else {
+        ectx->NewFile("shaders.wishp");
+        ectx->SendData(shStream);
+      }
     }
 
     if (!textures) {
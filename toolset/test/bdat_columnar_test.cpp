@@ -0,0 +1,231 @@
+/*  xenoblade_toolset tests
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "xenolib/bdat/columnar.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <stdexcept>
+
+static int numFailed = 0;
+
+static void Expect(bool condition, const char *what) {
+  if (!condition) {
+    printf("Failed: %s\n", what);
+    numFailed++;
+  }
+}
+
+// Hand built tables, string cells are offsets into string section
+namespace Fixture {
+const char STRINGS[] = "Sword\0Shield\0Slime";
+
+struct Item {
+  uint32 id;
+  uint32 name;
+  float rate;
+  int8 level;
+  uint8 flags;
+};
+
+const Item ITEMS[]{
+    {10, 0, 0.5f, -3, 0b100},
+    {20, 6, 1.5f, 7, 0b011},
+    {30, 0, 2.5f, 127, 0b111},
+};
+
+// Unsorted, writer must sort them
+const BDAT::V4::Key ITEM_KEYS[]{{0xC0C, 2}, {0xA11CE, 0}, {0xB0B, 1}};
+
+struct Enemy {
+  uint16 hp;
+  uint32 name;
+  uint32 drop;
+};
+
+const Enemy ENEMIES[]{{500, 13, 0}, {65535, 13, 0}};
+
+BDAT::TableView ItemView() {
+  BDAT::TableView view;
+  view.values = reinterpret_cast<const char *>(ITEMS);
+  view.stride = sizeof(Item);
+  view.numRows = std::size(ITEMS);
+  view.strings = {STRINGS, sizeof(STRINGS)};
+  view.rawStrings = true;
+  view.columns = {
+      {"Id", BDAT::DataType::u32, offsetof(Item, id)},
+      {"Name", BDAT::DataType::StringPtr, offsetof(Item, name)},
+      {"Rate", BDAT::DataType::Float, offsetof(Item, rate)},
+      {"Level", BDAT::DataType::i8, offsetof(Item, level)},
+      {"Rare", BDAT::DataType::u8, offsetof(Item, flags), 0b100},
+  };
+
+  return view;
+}
+
+BDAT::TableView EnemyView() {
+  BDAT::TableView view;
+  view.values = reinterpret_cast<const char *>(ENEMIES);
+  view.stride = sizeof(Enemy);
+  view.numRows = std::size(ENEMIES);
+  view.strings = {STRINGS, sizeof(STRINGS)};
+  view.rawStrings = true;
+  view.columns = {
+      {"Hp", BDAT::DataType::u16, offsetof(Enemy, hp)},
+      {"Name", BDAT::DataType::StringPtr, offsetof(Enemy, name)},
+      {"Drop", BDAT::DataType::StringPtr, offsetof(Enemy, drop)},
+  };
+
+  return view;
+}
+
+std::string Build() {
+  BDAT::Columnar::Writer writer;
+  writer.AddTable("ITM_Item", ItemView(), ITEM_KEYS);
+  writer.AddTable("ENE_Enemy", EnemyView());
+  writer.AddTable("SYS_Empty", BDAT::TableView{});
+
+  return writer.Build();
+}
+} // namespace Fixture
+
+template <class C>
+static bool Equal(std::span<const C> values,
+                  std::initializer_list<C> expected) {
+  return std::ranges::equal(values, expected);
+}
+
+static void TestSchema(const BDAT::Columnar::Reader &reader) {
+  Expect(reader.NumTables() == 3, "Table count");
+  Expect(reader.FindTable("ENE_Enemy") == 1, "FindTable");
+  Expect(reader.FindTable("MNU_Msg") == 3, "FindTable unknown");
+
+  auto items = reader.GetTable(0);
+  Expect(items.Name() == "ITM_Item", "Table name");
+  Expect(items.NumRows() == 3, "Row count");
+  Expect(items.NumColumns() == 5, "Column count");
+
+  const char *names[]{"Id", "Name", "Rate", "Level", "Rare"};
+  const BDAT::DataType types[]{
+      BDAT::DataType::u32, BDAT::DataType::StringPtr, BDAT::DataType::Float,
+      BDAT::DataType::i8,
+      // Flag columns are stored as 0/1 bytes
+      BDAT::DataType::u8};
+
+  for (size_t c = 0; c < items.NumColumns(); c++) {
+    Expect(items.ColumnName(c) == names[c], "Column name");
+    Expect(items.GetColumn(c).type == types[c], "Column type");
+  }
+
+  Expect(items.FindColumn("Level") == 3, "FindColumn");
+  Expect(items.FindColumn("Price") == 5, "FindColumn unknown");
+
+  auto empty = reader.GetTable(2);
+  Expect(empty.NumRows() == 0 && empty.NumColumns() == 0 &&
+             empty.Keys().empty(),
+         "Empty table");
+}
+
+static void TestValues(const BDAT::Columnar::Reader &reader) {
+  auto items = reader.GetTable(0);
+  Expect(Equal(items.Values<uint32>(0), {10u, 20u, 30u}), "u32 values");
+  Expect(Equal(items.Values<float>(2), {0.5f, 1.5f, 2.5f}), "Float values");
+  Expect(Equal<int8>(items.Values<int8>(3), {-3, 7, 127}), "i8 values");
+  Expect(Equal<uint8>(items.Values<uint8>(4), {1, 0, 1}), "Flag values");
+
+  auto enemies = reader.GetTable(1);
+  Expect(Equal<uint16>(enemies.Values<uint16>(0), {500, 65535}),
+         "u16 values");
+
+  bool thrown = false;
+
+  try {
+    items.Values<uint16>(0);
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+
+  Expect(thrown, "Value size mismatch throws");
+}
+
+static void TestStrings(const BDAT::Columnar::Reader &reader) {
+  auto items = reader.GetTable(0);
+  auto enemies = reader.GetTable(1);
+  Expect(items.String(0, 1) == "Sword" && items.String(1, 1) == "Shield" &&
+             items.String(2, 1) == "Sword",
+         "String values");
+  Expect(enemies.String(0, 1) == "Slime" && enemies.String(1, 2) == "Sword",
+         "String values of second table");
+
+  // Heap is deduplicated across tables
+  const uint32 sword = items.Values<uint32>(1)[0];
+  Expect(items.Values<uint32>(1)[2] == sword, "Deduplicated string");
+  Expect(enemies.Values<uint32>(2)[0] == sword,
+         "Deduplicated string across tables");
+  Expect(enemies.Values<uint32>(1)[0] != sword, "Distinct strings");
+}
+
+static void TestKeys(const BDAT::Columnar::Reader &reader) {
+  auto items = reader.GetTable(0);
+  auto keys = items.Keys();
+  Expect(std::ranges::is_sorted(keys, {}, &BDAT::Columnar::Key::hash),
+         "Keys are sorted");
+  Expect(keys.size() == 3, "Key count");
+
+  for (auto &k : Fixture::ITEM_KEYS) {
+    Expect(items.FindRow(k.hash) == k.index, "FindRow");
+  }
+
+  Expect(items.FindRow(0xDEAD) == -1, "FindRow unknown");
+  Expect(reader.GetTable(1).Keys().empty(), "Table without keys");
+  Expect(reader.GetTable(1).FindRow(0xA11CE) == -1, "FindRow without keys");
+}
+
+static void TestInvalid(const std::string &data) {
+  auto Throws = [](std::string_view data) {
+    try {
+      BDAT::Columnar::Reader reader(data);
+    } catch (const std::exception &) {
+      return true;
+    }
+
+    return false;
+  };
+
+  std::string badId(data);
+  badId[0] = 'X';
+  Expect(Throws(badId), "Invalid id throws");
+  Expect(Throws(std::string_view(data).substr(0, 16)), "Small data throws");
+  Expect(Throws(std::string_view(data).substr(0, data.size() - 1)),
+         "Truncated data throws");
+}
+
+int main() {
+  const std::string data = Fixture::Build();
+  BDAT::Columnar::Reader reader(data);
+  TestSchema(reader);
+  TestValues(reader);
+  TestStrings(reader);
+  TestKeys(reader);
+  TestInvalid(data);
+
+  if (numFailed) {
+    printf("%i checks failed\n", numFailed);
+  }
+
+  return numFailed ? 1 : 0;
+}
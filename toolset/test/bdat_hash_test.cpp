@@ -0,0 +1,115 @@
+/*  xenoblade_toolset tests
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "xenolib/bdat/hash_dictionary.hpp"
+#include <cstdio>
+#include <string>
+
+static int numFailed = 0;
+
+static void Expect(bool condition, const char *what) {
+  if (!condition) {
+    printf("Failed: %s\n", what);
+    numFailed++;
+  }
+}
+
+// Expected values were produced by reference murmur3 (x86, 32 bit)
+static void TestHashLabel() {
+  struct {
+    const char *label;
+    uint32 seed;
+    uint32 hash;
+  } const VECTORS[]{
+      {"", 0, 0},
+      {"", 1, 0x514E28B7},
+      {"test", 0, 0xBA6BD213},
+      {"Hello, world!", 0, 0xC0363E43},
+      {"The quick brown fox jumps over the lazy dog", 0, 0x2E4FF723},
+      // Table and column labels, all tail lengths
+      {"ID", 0, 0xDBEA0DF4},
+      {"Name", 0, 0x25EFA387},
+      {"CHR_PC", 0, 0xA36067CF},
+      {"MNU_Msg", 0, 0x64934E95},
+      {"DebugName", 0, 0x50C06388},
+      {"ITM_PcWpn", 0, 0xAEB037CC},
+  };
+
+  for (auto &v : VECTORS) {
+    if (BDAT::HashLabel(v.label, v.seed) != v.hash) {
+      printf("Failed: HashLabel(\"%s\", %u)\n", v.label, v.seed);
+      numFailed++;
+    }
+  }
+}
+
+// Label62129 and Label115897 both hash to 0xEE0E718C.
+// Surrounding names make list large enough for introsort, with this
+// placement libstdc++ std::sort swaps colliding names.
+static std::string NameList(const char *first, const char *second) {
+  std::string list("# Collision test\r\n\n");
+
+  for (int i = 0; i < 200; i++) {
+    list.append("Filler" + std::to_string(i) + "\r\n");
+
+    if (i == 0) {
+      list.append(first).append("\n");
+    } else if (i == 10) {
+      list.append(second).append("\n");
+    }
+  }
+
+  return list;
+}
+
+static void TestDictionary() {
+  const uint32 COLLISION = 0xEE0E718C;
+  BDAT::HashDictionary dict;
+  dict.Load(NameList("Label62129", "Label115897"));
+
+  Expect(dict.Size() == 201, "Colliding names are stored once");
+  Expect(dict.Find(COLLISION) == "Label62129", "First listed name wins");
+  Expect(dict.Find(BDAT::HashLabel("Filler0")) == "Filler0", "Find");
+  Expect(dict.Find(BDAT::HashLabel("Filler199")) == "Filler199",
+         "Find last name");
+  Expect(dict.Find(BDAT::HashLabel("# Collision test")).empty(),
+         "Comments are skipped");
+  Expect(dict.Find(0xDEADBEEF).empty(), "Find unknown");
+
+  Expect(dict.Resolve("<EE0E718C>") == "Label62129", "Resolve");
+  Expect(dict.Resolve("<ee0e718c>") == "Label62129", "Resolve lowercase");
+  Expect(dict.Resolve("<DEADBEEF>") == "<DEADBEEF>", "Resolve unknown");
+  Expect(dict.Resolve("Name") == "Name", "Resolve plain label");
+
+  dict.Load(NameList("Label115897", "Label62129"));
+  Expect(dict.Find(COLLISION) == "Label115897",
+         "First listed name wins, swapped order");
+
+  dict.Load("");
+  Expect(dict.Size() == 0 && dict.Find(COLLISION).empty(), "Empty list");
+}
+
+int main() {
+  TestHashLabel();
+  TestDictionary();
+
+  if (numFailed) {
+    printf("%i checks failed\n", numFailed);
+  }
+
+  return numFailed ? 1 : 0;
+}
@@ -0,0 +1,190 @@
+/*  xenoblade_toolset tests
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "xenolib/bdat/join.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <stdexcept>
+
+static int numFailed = 0;
+
+static void Expect(bool condition, const char *what) {
+  if (!condition) {
+    printf("Failed: %s\n", what);
+    numFailed++;
+  }
+}
+
+// Hand built fixture, row ids start at 1
+namespace Fixture {
+struct Item {
+  uint32 price;
+};
+
+const Item ITEMS[]{{100}, {200}, {300}};
+
+struct Pc {
+  uint16 defWeapon;
+  uint32 partner;
+};
+
+const Pc PCS[]{
+    {2, 0xB0B},
+    {3, 0},
+    // Out of range weapon id, must not be linked
+    {9, 0xA11CE},
+};
+
+const BDAT::V4::Key PC_KEYS[]{{0xA11CE, 0}, {0xB0B, 1}, {0xC0C, 2}};
+
+constexpr uint32 ITM = 0;
+constexpr uint32 CHR = 1;
+
+BDAT::TableView ItemView() {
+  BDAT::TableView view;
+  view.values = reinterpret_cast<const char *>(ITEMS);
+  view.stride = sizeof(Item);
+  view.numRows = std::size(ITEMS);
+  view.columns.emplace_back(
+      BDAT::ColumnView{"Price", BDAT::DataType::u32, offsetof(Item, price)});
+
+  return view;
+}
+
+BDAT::TableView PcView() {
+  BDAT::TableView view;
+  view.values = reinterpret_cast<const char *>(PCS);
+  view.stride = sizeof(Pc);
+  view.numRows = std::size(PCS);
+  view.columns.emplace_back(BDAT::ColumnView{
+      "DefWeapon", BDAT::DataType::u16, offsetof(Pc, defWeapon)});
+  view.columns.emplace_back(BDAT::ColumnView{
+      "Partner", BDAT::DataType::KeyHash, offsetof(Pc, partner)});
+
+  return view;
+}
+
+BDAT::JoinIndex MakeIndex(bool linkKeyHashes) {
+  BDAT::JoinIndex index;
+  index.AddTable({"ITM_Item", ItemView(), {}, 1});
+  index.AddTable({"CHR_Pc", PcView(), PC_KEYS, 1});
+  index.AddRelation("CHR_Pc", "DefWeapon", "ITM_Item");
+  index.Build(linkKeyHashes);
+
+  return index;
+}
+} // namespace Fixture
+
+static bool Equal(std::span<const BDAT::Reference> refs,
+                  std::initializer_list<BDAT::Reference> expected) {
+  return std::ranges::equal(refs, expected, [](auto &a, auto &b) {
+    return a.row == b.row && a.column == b.column;
+  });
+}
+
+static bool Equal(const std::vector<BDAT::RowRef> &rows,
+                  std::initializer_list<BDAT::RowRef> expected) {
+  return std::ranges::equal(rows, expected);
+}
+
+static void TestForward(const BDAT::JoinIndex &index) {
+  using namespace Fixture;
+  Expect(index.FindTable("CHR_Pc") == CHR, "FindTable");
+  Expect(index.FindTable("MNU_Msg") == -1, "FindTable unknown");
+
+  // Declared relation first, key hash column second
+  Expect(Equal(index.Forward({CHR, 0}), {{{ITM, 1}, 0}, {{CHR, 1}, 1}}),
+         "Forward relation and key hash");
+  Expect(Equal(index.Forward({CHR, 1}), {{{ITM, 2}, 0}}),
+         "Forward zero hash is not linked");
+  Expect(Equal(index.Forward({CHR, 2}), {{{CHR, 0}, 1}}),
+         "Forward out of range id is not linked");
+  Expect(index.Forward({ITM, 0}).empty(), "Forward without references");
+}
+
+static void TestReverse(const BDAT::JoinIndex &index) {
+  using namespace Fixture;
+  Expect(Equal(index.Reverse({ITM, 1}), {{{CHR, 0}, 0}}), "Reverse relation");
+  Expect(Equal(index.Reverse({ITM, 2}), {{{CHR, 1}, 0}}),
+         "Reverse relation last row");
+  Expect(index.Reverse({ITM, 0}).empty(), "Reverse unreferenced row");
+  Expect(Equal(index.Reverse({CHR, 0}), {{{CHR, 2}, 1}}), "Reverse key hash");
+  Expect(index.Reverse({CHR, 2}).empty(), "Reverse unreferenced key");
+}
+
+static void TestMultiHop(const BDAT::JoinIndex &index) {
+  using namespace Fixture;
+  std::string_view path[]{"Partner", "DefWeapon", "Price"};
+
+  Expect(Equal(index.Follow({CHR, 2}, std::span(path).first(2)), {{ITM, 1}}),
+         "Follow two hops");
+  Expect(index.Follow({CHR, 1}, std::span(path).first(2)).empty(),
+         "Follow dead end");
+
+  auto prices = index.Resolve({CHR, 2}, path);
+  Expect(prices.size() == 1 && prices[0].asInt == 200, "Resolve two hops");
+
+  Expect(Equal(index.Reachable({CHR, 2}, 1), {{CHR, 0}}), "Reachable one hop");
+  Expect(Equal(index.Reachable({CHR, 2}, 3),
+               {{CHR, 0}, {ITM, 1}, {CHR, 1}, {ITM, 2}}),
+         "Reachable three hops");
+  Expect(Equal(index.Reachable({ITM, 2}, 3, true),
+               {{CHR, 1}, {CHR, 0}, {CHR, 2}}),
+         "Reachable reverse");
+}
+
+int main() {
+  using namespace Fixture;
+  BDAT::JoinIndex index = MakeIndex(true);
+  TestForward(index);
+  TestReverse(index);
+  TestMultiHop(index);
+
+  BDAT::JoinIndex noHashes = MakeIndex(false);
+  Expect(Equal(noHashes.Forward({CHR, 0}), {{{ITM, 1}, 0}}),
+         "Key hashes are not linked when disabled");
+
+  bool thrown = false;
+
+  try {
+    index.Forward({CHR, 3});
+  } catch (const std::out_of_range &) {
+    thrown = true;
+  }
+
+  Expect(thrown, "Out of range row throws");
+
+  BDAT::JoinIndex unknown;
+  unknown.AddTable({"CHR_Pc", PcView(), {}, 1});
+  unknown.AddRelation("CHR_Pc", "DefWeapon", "ITM_Item");
+  thrown = false;
+
+  try {
+    unknown.Build();
+  } catch (const std::runtime_error &) {
+    thrown = true;
+  }
+
+  Expect(thrown, "Relation to unknown table throws");
+
+  if (numFailed) {
+    printf("%i checks failed\n", numFailed);
+  }
+
+  return numFailed ? 1 : 0;
+}
@@ -0,0 +1,457 @@
+/*  xenoblade_toolset tests
+    Copyright(C) 2023 Lukas Cone
+
+    This program is free software : you can redistribute it and / or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "meshopt_compression.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <random>
+
+// Decoders follow EXT_meshopt_compression specification, they are kept out
+// of toolset, which only ever encodes.
+namespace Meshopt {
+using namespace detail;
+
+struct Reader {
+  const uint8 *data;
+  const uint8 *end;
+
+  uint8 Byte() {
+    if (data >= end) {
+      throw std::runtime_error("Meshopt stream is truncated");
+    }
+
+    return *data++;
+  }
+};
+
+static void DecodeBytes(Reader &rd, uint8 *buffer, size_t size) {
+  const size_t headerSize = (size / BYTE_GROUP_SIZE + 3) / 4;
+
+  if (size_t(rd.end - rd.data) < headerSize) {
+    throw std::runtime_error("Meshopt stream is truncated");
+  }
+
+  const uint8 *header = rd.data;
+  rd.data += headerSize;
+
+  for (size_t i = 0; i < size; i += BYTE_GROUP_SIZE) {
+    const size_t group = i / BYTE_GROUP_SIZE;
+    const uint32 bitsLog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+    uint8 *values = buffer + i;
+
+    if (bitsLog2 == 0) {
+      std::fill_n(values, BYTE_GROUP_SIZE, 0);
+      continue;
+    }
+
+    if (bitsLog2 == 3) {
+      for (size_t v = 0; v < BYTE_GROUP_SIZE; v++) {
+        values[v] = rd.Byte();
+      }
+
+      continue;
+    }
+
+    const uint32 bits = 1 << bitsLog2;
+    const uint8 sentinel = (1 << bits) - 1;
+    const size_t valuesPerByte = 8 / bits;
+    uint8 packed[8];
+
+    for (size_t b = 0; b < BYTE_GROUP_SIZE / valuesPerByte; b++) {
+      packed[b] = rd.Byte();
+    }
+
+    for (size_t v = 0; v < BYTE_GROUP_SIZE; v++) {
+      const size_t shift = 8 - bits * (v % valuesPerByte + 1);
+      const uint8 value = (packed[v / valuesPerByte] >> shift) & sentinel;
+      values[v] = value == sentinel ? rd.Byte() : value;
+    }
+  }
+}
+
+static uint32 DecodeVByte(Reader &rd) {
+  uint8 lead = rd.Byte();
+
+  if (lead < 128) {
+    return lead;
+  }
+
+  uint32 result = lead & 127;
+
+  for (uint32 shift = 7; shift < 35; shift += 7) {
+    const uint8 group = rd.Byte();
+    result |= uint32(group & 127) << shift;
+
+    if (group < 128) {
+      break;
+    }
+  }
+
+  return result;
+}
+
+static uint32 DecodeIndex(IndexState &st, Reader &rd) {
+  const uint32 v = DecodeVByte(rd);
+  st.last += (v >> 1) ^ -int32(v & 1);
+  return st.last;
+}
+
+static void DecodeVertexBuffer(char *vertices, size_t numVertices,
+                               size_t vertexSize, std::string_view encoded) {
+  if (vertexSize == 0 || vertexSize > 256 || vertexSize % 4) {
+    throw std::invalid_argument("Invalid meshopt vertex size");
+  }
+
+  const size_t tailSize = std::max(vertexSize, TAIL_MAX_SIZE);
+  auto begin = reinterpret_cast<const uint8 *>(encoded.data());
+
+  if (encoded.size() < 1 + tailSize || begin[0] != VERTEX_HEADER) {
+    throw std::runtime_error("Invalid meshopt vertex stream");
+  }
+
+  Reader rd{begin + 1, begin + encoded.size() - tailSize};
+  uint8 lastVertex[256];
+  memcpy(lastVertex, begin + encoded.size() - vertexSize, vertexSize);
+  const size_t blockSize = VertexBlockSize(vertexSize);
+  uint8 buffer[VERTEX_BLOCK_MAX_SIZE];
+  auto data = reinterpret_cast<uint8 *>(vertices);
+
+  for (size_t offset = 0; offset < numVertices; offset += blockSize) {
+    const size_t numBlockVerts = std::min(blockSize, numVertices - offset);
+    const size_t alignedVerts =
+        (numBlockVerts + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+    uint8 *block = data + offset * vertexSize;
+
+    for (size_t k = 0; k < vertexSize; k++) {
+      DecodeBytes(rd, buffer, alignedVerts);
+      uint8 prev = lastVertex[k];
+
+      for (size_t i = 0; i < numBlockVerts; i++) {
+        const uint8 zigzag = buffer[i];
+        prev += (zigzag >> 1) ^ -(zigzag & 1);
+        block[i * vertexSize + k] = prev;
+      }
+    }
+
+    memcpy(lastVertex, block + (numBlockVerts - 1) * vertexSize, vertexSize);
+  }
+
+  if (rd.data != rd.end) {
+    throw std::runtime_error("Invalid meshopt vertex stream size");
+  }
+}
+
+static std::vector<uint32> DecodeIndexBuffer(std::string_view encoded,
+                                             size_t numIndices) {
+  auto begin = reinterpret_cast<const uint8 *>(encoded.data());
+
+  if (numIndices % 3 || encoded.size() < 1 + numIndices / 3 + 16 ||
+      (begin[0] & 0xf0) != (INDEX_HEADER & 0xf0) || (begin[0] & 0xf) > 1) {
+    throw std::runtime_error("Invalid meshopt index stream");
+  }
+
+  const int32 fecMax = (begin[0] & 0xf) >= 1 ? 13 : 15;
+  const uint8 *code = begin + 1;
+  const uint8 *table = begin + encoded.size() - 16;
+  Reader rd{code + numIndices / 3, table};
+  IndexState st;
+  std::vector<uint32> indices;
+  indices.reserve(numIndices);
+
+  for (size_t i = 0; i < numIndices; i += 3) {
+    const uint8 codeTri = *code++;
+    uint32 a, b, c;
+
+    if (codeTri < 0xf0) {
+      auto &edge = st.edges[(st.edgeOffset - 1 - (codeTri >> 4)) & 15];
+      a = edge[0];
+      b = edge[1];
+      const int32 fec = codeTri & 15;
+
+      if (fec < fecMax) {
+        c = fec == 0 ? st.next++
+                     : st.vertices[(st.vertexOffset - 1 - fec) & 15];
+        st.PushVertex(c, fec == 0);
+      } else {
+        c = fec == 15 ? DecodeIndex(st, rd)
+                      : (st.last += fec == 13 ? -1 : 1);
+        st.PushVertex(c);
+      }
+
+      st.PushEdge(c, b);
+      st.PushEdge(a, c);
+    } else {
+      int32 fea = 0;
+      uint8 codeAux;
+
+      if (codeTri < 0xfe) {
+        codeAux = table[codeTri & 15];
+      } else {
+        codeAux = rd.Byte();
+        fea = codeTri == 0xfe ? 0 : 15;
+
+        if (codeAux == 0) {
+          st.next = 0;
+        }
+      }
+
+      const int32 feb = codeAux >> 4;
+      const int32 fec = codeAux & 15;
+
+      auto FromFifo = [&](int32 fe) {
+        return fe == 0 ? st.next++ : st.vertices[(st.vertexOffset - fe) & 15];
+      };
+
+      a = fea == 0 ? st.next++ : 0;
+      b = FromFifo(feb);
+      c = FromFifo(fec);
+
+      if (fea == 15) {
+        a = DecodeIndex(st, rd);
+      }
+
+      if (feb == 15) {
+        b = DecodeIndex(st, rd);
+      }
+
+      if (fec == 15) {
+        c = DecodeIndex(st, rd);
+      }
+
+      st.PushVertex(a);
+      st.PushVertex(b, feb == 0 || feb == 15);
+      st.PushVertex(c, fec == 0 || fec == 15);
+      st.PushEdge(b, a);
+      st.PushEdge(c, b);
+      st.PushEdge(a, c);
+    }
+
+    indices.insert(indices.end(), {a, b, c});
+  }
+
+  if (rd.data != rd.end) {
+    throw std::runtime_error("Invalid meshopt index stream size");
+  }
+
+  return indices;
+}
+} // namespace Meshopt
+
+// Reference vectors, input data come from meshoptimizer test suite
+namespace Reference {
+// Encoded by meshoptimizer (kIndexDataV1), exercises edge fifo,
+// vertex fifo, next vertex and explicit index codes.
+const uint32 INDICES[]{0, 1, 2, 2, 1, 3, 0, 1, 2, 2, 1, 5, 2, 1, 4};
+const uint8 INDICES_ENCODED[]{
+    0xe1, 0xf0, 0x10, 0xfe, 0x1f, 0x3d, 0x00, 0x0a, 0x00, 0x76, 0x87, 0x56,
+    0x67, 0x78, 0xa9, 0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00,
+};
+
+// Version 0 stream encoded by meshoptimizer (kIndexDataV0), decoders must
+// accept it as well
+const uint32 INDICES_V0[]{0, 1, 2, 2, 1, 3, 4, 6, 5, 7, 8, 9};
+const uint8 INDICES_V0_ENCODED[]{
+    0xe0, 0xf0, 0x10, 0xfe, 0xff, 0xf0, 0x0c, 0xff, 0x02,
+    0x02, 0x02, 0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9,
+    0x86, 0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00,
+};
+
+// Vertex: px, py, pz, nu, nv, tx, ty
+struct Vertex {
+  uint16 px, py, pz;
+  uint8 nu, nv;
+  uint16 tx, ty;
+};
+
+const Vertex VERTICES[]{
+    {0, 0, 0, 0, 0, 0, 0},
+    {300, 0, 0, 0, 0, 500, 0},
+    {0, 300, 0, 0, 0, 0, 500},
+    {300, 300, 0, 0, 0, 500, 500},
+};
+
+// Single block, one byte group per vertex byte. Every group has 2 bit mode
+// header byte, then zigzag deltas to previous vertex, packed 2 bits per
+// value with 3 as sentinel for following raw byte.
+const uint8 VERTICES_ENCODED[]{
+    0xa0,
+    // px low: 0x00 0x2c 0x00 0x2c, deltas 0 +44 -44 +44
+    0x01, 0x3f, 0x00, 0x00, 0x00, 0x58, 0x57, 0x58,
+    // px high: 0 1 0 1
+    0x01, 0x26, 0x00, 0x00, 0x00,
+    // py low: 0x00 0x00 0x2c 0x2c
+    0x01, 0x0c, 0x00, 0x00, 0x00, 0x58,
+    // py high: 0 0 1 1
+    0x01, 0x08, 0x00, 0x00, 0x00,
+    // pz, nu, nv: all zero groups
+    0x00, 0x00, 0x00, 0x00,
+    // tx low: 0x00 0xf4 0x00 0xf4, deltas 0 -12 +12 -12
+    0x01, 0x3f, 0x00, 0x00, 0x00, 0x17, 0x18, 0x17,
+    // tx high: 0 1 0 1
+    0x01, 0x26, 0x00, 0x00, 0x00,
+    // ty low: 0x00 0x00 0xf4 0xf4
+    0x01, 0x0c, 0x00, 0x00, 0x00, 0x17,
+    // ty high: 0 0 1 1
+    0x01, 0x08, 0x00, 0x00, 0x00,
+    // Tail of 32 bytes, ends with first vertex
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
+
+std::string_view View(std::span<const uint8> data) {
+  return {reinterpret_cast<const char *>(data.data()), data.size()};
+}
+} // namespace Reference
+
+// Encoders must produce reference bytes, decoders must restore reference data
+static int TestReference() {
+  using namespace Reference;
+  int numFailed = 0;
+
+  if (Meshopt::EncodeIndexBuffer(INDICES) != View(INDICES_ENCODED)) {
+    printf("Index encoder does not match reference\n");
+    numFailed++;
+  }
+
+  if (!std::ranges::equal(
+          Meshopt::DecodeIndexBuffer(View(INDICES_ENCODED), 15), INDICES) ||
+      !std::ranges::equal(
+          Meshopt::DecodeIndexBuffer(View(INDICES_V0_ENCODED), 12),
+          INDICES_V0)) {
+    printf("Index decoder does not match reference\n");
+    numFailed++;
+  }
+
+  auto vertices = reinterpret_cast<const char *>(VERTICES);
+
+  if (Meshopt::EncodeVertexBuffer(vertices, 4, sizeof(Vertex)) !=
+      View(VERTICES_ENCODED)) {
+    printf("Vertex encoder does not match reference\n");
+    numFailed++;
+  }
+
+  Vertex decoded[4]{};
+  Meshopt::DecodeVertexBuffer(reinterpret_cast<char *>(decoded), 4,
+                              sizeof(Vertex), View(VERTICES_ENCODED));
+
+  if (memcmp(decoded, VERTICES, sizeof(VERTICES))) {
+    printf("Vertex decoder does not match reference\n");
+    numFailed++;
+  }
+
+  return numFailed;
+}
+
+// Encoded data must decode into original bytes
+static bool TestVertices(size_t stride, size_t numVertices) {
+  std::mt19937 rng(stride * 1000 + numVertices);
+  std::vector<char> vertices(stride * numVertices);
+
+  for (size_t i = 0; i < vertices.size(); i++) {
+    // Mix of noise and slowly changing bytes, like real attributes
+    vertices[i] = i % 3 ? char(i / stride / 7) : char(rng());
+  }
+
+  std::string encoded =
+      Meshopt::EncodeVertexBuffer(vertices.data(), numVertices, stride);
+  std::vector<char> decoded(vertices.size());
+  Meshopt::DecodeVertexBuffer(decoded.data(), numVertices, stride, encoded);
+
+  return decoded == vertices;
+}
+
+// Codec may rotate vertices within triangle, winding is kept
+static bool TestIndices(const std::vector<uint32> &indices) {
+  std::string encoded = Meshopt::EncodeIndexBuffer(indices);
+  std::vector<uint32> decoded =
+      Meshopt::DecodeIndexBuffer(encoded, indices.size());
+
+  if (decoded.size() != indices.size()) {
+    return false;
+  }
+
+  for (size_t t = 0; t < indices.size(); t += 3) {
+    const uint32 *o = &indices[t];
+    const uint32 *d = &decoded[t];
+    const bool same = (d[0] == o[0] && d[1] == o[1] && d[2] == o[2]) ||
+                      (d[0] == o[1] && d[1] == o[2] && d[2] == o[0]) ||
+                      (d[0] == o[2] && d[1] == o[0] && d[2] == o[1]);
+
+    if (!same) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main() {
+  int numFailed = TestReference();
+
+  for (size_t stride : {4, 8, 12, 16, 20, 64, 256}) {
+    for (size_t numVertices : {0, 1, 15, 16, 17, 255, 256, 257, 5000}) {
+      if (!TestVertices(stride, numVertices)) {
+        printf("Vertex round trip failed, stride: %zu, vertices: %zu\n",
+               stride, numVertices);
+        numFailed++;
+      }
+    }
+  }
+
+  // Triangulated grid, shuffled copy with large indices and sequence
+  // exercising edge and vertex fifo hits
+  const uint32 gridSize = 60;
+  std::vector<uint32> grid;
+
+  for (uint32 y = 0; y + 1 < gridSize; y++) {
+    for (uint32 x = 0; x + 1 < gridSize; x++) {
+      const uint32 a = y * gridSize + x;
+      const uint32 c = a + gridSize;
+      grid.insert(grid.end(), {a, a + 1, c, a + 1, c + 1, c});
+    }
+  }
+
+  std::vector<uint32> shuffled(grid);
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(7));
+
+  for (uint32 &i : shuffled) {
+    i = i * 7 % (gridSize * gridSize) + 100000;
+  }
+
+  const std::vector<uint32> indexSets[]{
+      {},
+      {0, 1, 2},
+      {0, 1, 2, 3, 4, 5, 0, 1, 2, 2, 1, 0, 1, 1, 1},
+      grid,
+      shuffled,
+  };
+
+  for (size_t index = 0; auto &s : indexSets) {
+    if (!TestIndices(s)) {
+      printf("Index round trip failed, set: %zu\n", index);
+      numFailed++;
+    }
+
+    index++;
+  }
+
+  return numFailed ? 1 : 0;
+}